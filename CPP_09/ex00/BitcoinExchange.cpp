@@ -1,151 +1,715 @@
 #include "BitcoinExchange.hpp"
 
-static void parseDate (const std::string &date)
-{
-    int y, m, d;
-    if (sscanf(date.c_str(), "%d-%d-%d", &y, &m, &d) != 3)
-        throw std::runtime_error("invalid date: " + date);
-
-    if (y < 1 || d < 1 || d > 31 || m < 1 || m > 12)
-        throw std::runtime_error ("Error: bad input => " + date);
-}
+#include <fcntl.h>
+#include <time.h>
+#include <sched.h>
 
+// the parsed table is cached next to the csv as <file>.snap. it is only
+// used while the csv still has the size, inode, mtime and ctime (to the
+// nanosecond, so a same size rewrite within a second counts) it was built
+// from, otherwise the csv is parsed again and the snapshot rewritten.
 void BitcoinExchange::parse (const std::string &fileName)
 {
-    std::fstream file (fileName.c_str());
-    if (!file.is_open ())
+    struct stat st;
+    if (stat (fileName.c_str (), &st) < 0)
         throw std::runtime_error ("Error: could not open file");
-    std::string line;
-    int i = 0;
-    while (std::getline (file, line))
+    FileName = fileName;
+    Inode = st.st_ino;
+
+    RateTable *table = new RateTable;
+    std::string snapshot = fileName + ".snap";
+    if (table->loadSnapshot (snapshot, st))
     {
-        if (i++ == 0)
-        {
-            if (line != "date,exchange_rate")
-                throw std::runtime_error ("Error: invalid header");
-            continue;
-        }
-        size_t pos = line.find (",");
-        if (pos != std::string::npos)
-        {
-            std::string date = line.substr (0, pos);
-            parseDate (date);
-            std::stringstream ss (line.substr (pos + 1));
-            double value;
-            if (!(ss >> value) || !(ss >> std::ws).eof() || value < 0) // std::ws is a stream manipulator, it is actually a function, std::ws(ss). katscipi ga3 leading spaces.
-                throw std::runtime_error("Error: invalid value");
-            DateValue[date] = value;
-        }
-        else
-            throw std::runtime_error ("Error: invalid line format");
+        Offset = st.st_size;
+        publish (table);
+        return;
     }
+    try
+    {
+        MappedFile file;
+        if (!file.open (fileName))
+            throw std::runtime_error ("Error: could not open file");
+        table->loadCsv (file.data (), file.size (), true);
+        table->finalize ();
+        Offset = file.size ();
+    }
+    catch (...)
+    {
+        delete table;
+        throw;
+    }
+    table->writeSnapshot (snapshot, st);
+    publish (table);
+}
 
-    if (i == 0)
-        throw std::runtime_error ("Error: empty file");
-    if (file.eof ())
-        file.close ();
-     else
-        throw std::runtime_error ("Error: could not read file");
-
+void BitcoinExchange::init ()
+{
+    Current = NULL;
+    Assets = NULL;
+    Entering[0] = 0;
+    Entering[1] = 0;
+    Epoch = 0;
+    Policy = RateTable::PreviousClose;
+    Offset = 0;
+    Inode = 0;
+    Following = false;
+    StopFollowing = false;
+    pthread_mutex_init (&ReloadLock, NULL);
 }
 
 BitcoinExchange::BitcoinExchange ()
 {
+    init ();
     parse ("data.csv");
 }
 
 BitcoinExchange::BitcoinExchange (const std::string &fileName)
 {
+    init ();
     parse (fileName);
 }
 
 BitcoinExchange::BitcoinExchange (const BitcoinExchange &other)
 {
+    init ();
     *this = other;
 }
 
+// a copy gets its own table with the other one's current rates. it follows
+// nothing, call follow () on it if it should.
 BitcoinExchange &BitcoinExchange::operator= (const BitcoinExchange &obj)
 {
     if (this != &obj)
-        DateValue = obj.DateValue;
+    {
+        Version *version = obj.acquire ();
+        RateTable *copy = new RateTable (*version->table);
+        obj.release (version);
+        publish (copy);
+        pthread_mutex_lock (&ReloadLock);
+        FileName = obj.FileName;
+        Offset = obj.Offset;
+        Inode = obj.Inode;
+        pthread_mutex_unlock (&ReloadLock);
+        Policy = obj.Policy;
+        delete Assets;
+        Assets = obj.Assets ? new RateStore (*obj.Assets) : NULL;
+    }
     return *this;
 }
 
 BitcoinExchange::~BitcoinExchange ()
 {
+    stopFollowing ();
+    if (Current)
+        release (Current);
+    delete Assets;
+    pthread_mutex_destroy (&ReloadLock);
 }
 
-static std::string trimWhiteSpaces (const std::string &str)
+// rates for other assets, answering `date | asset | value` lines. call it
+// before answering anything, the store isn't swapped under readers.
+void BitcoinExchange::loadAssets (const std::string &fileName)
 {
-    size_t start = str.find_first_not_of (" \t");
-    size_t end = str.find_last_not_of (" \t");
-    if (start == std::string::npos || end == std::string::npos)
-        return "";
-    return str.substr (start, end - start + 1);
+    MappedFile file;
+    if (!file.open (fileName))
+        throw std::runtime_error ("Error: could not open file");
+    RateStore *store = new RateStore;
+    try
+    {
+        store->loadCsv (file.data (), file.size ());
+    }
+    catch (...)
+    {
+        delete store;
+        throw;
+    }
+    delete Assets;
+    Assets = store;
 }
 
-void BitcoinExchange::printall (const std::string &inputFile)
+// how a date without its own rate is priced, PreviousClose by default.
+void BitcoinExchange::setLookup (RateTable::Lookup policy)
 {
-    std::fstream file (inputFile.c_str());
-    if (!file.is_open ())
-        throw std::runtime_error ("Error: could not open file");
-    std::string line;
-    int i = 0;
-    while (std::getline (file, line))
+    Policy = policy;
+}
+
+// tables are immutable once published. a reader takes a reference on the
+// current Version and keeps using that one table until release (), so a
+// batch never sees two versions, and the last reference frees it.
+// loading Current and counting the reference are two steps, so a reader
+// stands in Entering[epoch & 1] between them. publish () swaps the pointer
+// atomically, then waits until nobody stands in either half. it flips
+// Epoch before each wait, so new readers go to the other half and the
+// wait only covers the few that were already there.
+BitcoinExchange::Version *BitcoinExchange::acquire () const
+{
+    int *entering = &Entering[__atomic_load_n (&Epoch, __ATOMIC_SEQ_CST) & 1];
+    __atomic_add_fetch (entering, 1, __ATOMIC_SEQ_CST);
+    Version *version = __atomic_load_n (&Current, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch (&version->refs, 1, __ATOMIC_SEQ_CST);
+    __atomic_sub_fetch (entering, 1, __ATOMIC_SEQ_CST);
+    return version;
+}
+
+void BitcoinExchange::release (Version *version) const
+{
+    if (__atomic_sub_fetch (&version->refs, 1, __ATOMIC_SEQ_CST) != 0)
+        return;
+    delete version->table;
+    delete version;
+}
+
+void BitcoinExchange::publish (RateTable *table)
+{
+    Version *version = new Version;
+    version->table = table;
+    version->refs = 1;
+    pthread_mutex_lock (&ReloadLock);
+    Version *old = __atomic_exchange_n (&Current, version, __ATOMIC_SEQ_CST);
+    for (int half = 0; half < 2; half++)
     {
+        unsigned epoch = __atomic_add_fetch (&Epoch, 1, __ATOMIC_SEQ_CST);
+        while (__atomic_load_n (&Entering[(epoch - 1) & 1], __ATOMIC_SEQ_CST) != 0)
+            sched_yield ();
+    }
+    pthread_mutex_unlock (&ReloadLock);
+    if (old)
+        release (old);
+}
+
+// picks up rows appended to the csv since the last load: only the new
+// complete lines are read and parsed, and a copy of the current table
+// with them added is published. a csv that was replaced, truncated or
+// rewritten in place (no longer continuing at a line start) is loaded
+// again from scratch. returns true when a new table was published.
+bool BitcoinExchange::refresh ()
+{
+    pthread_mutex_lock (&ReloadLock);
+    std::string fileName = FileName;
+    off_t offset = Offset;
+    ino_t inode = Inode;
+    pthread_mutex_unlock (&ReloadLock);
 
-        line = trimWhiteSpaces (line);
+    struct stat st;
+    if (fileName.empty () || stat (fileName.c_str (), &st) < 0 || st.st_size == offset)
+        return false;
+    if (st.st_ino != inode || st.st_size < offset)
+    {
+        reload (fileName);
+        return true;
+    }
 
-        if (i++ == 0)
+    int fd = open (fileName.c_str (), O_RDONLY);
+    if (fd < 0)
+        return false;
+    std::vector<char> text (st.st_size - offset + 1);
+    // the byte before the new text has to end the last line we parsed
+    ssize_t n = pread (fd, &text[0], text.size (), offset - 1);
+    close (fd);
+    if (n <= 0)
+        return false;
+    if (text[0] != '\n')
+    {
+        reload (fileName);
+        return true;
+    }
+    const char *begin = &text[1];
+    const char *end = &text[0] + n;
+    while (end > begin && end[-1] != '\n')
+        end--;
+    if (end == begin)
+        return false;
+
+    Version *version = acquire ();
+    RateTable *next = new RateTable (*version->table);
+    release (version);
+    try
+    {
+        next->loadCsv (begin, end - begin, false);
+        next->finalize ();
+    }
+    catch (...)
+    {
+        delete next;
+        throw;
+    }
+    pthread_mutex_lock (&ReloadLock);
+    Offset = offset + (end - begin);
+    pthread_mutex_unlock (&ReloadLock);
+    publish (next);
+    return true;
+}
+
+void BitcoinExchange::reload (const std::string &fileName)
+{
+    BitcoinExchange fresh (fileName);
+    RateTable *table = fresh.Current->table;
+    fresh.Current->table = NULL;
+    pthread_mutex_lock (&ReloadLock);
+    Offset = fresh.Offset;
+    Inode = fresh.Inode;
+    pthread_mutex_unlock (&ReloadLock);
+    publish (table);
+}
+
+void *BitcoinExchange::followLoop (void *self)
+{
+    BitcoinExchange *btc = static_cast<BitcoinExchange *> (self);
+    unsigned elapsed = 0;
+    while (!__atomic_load_n (&btc->StopFollowing, __ATOMIC_SEQ_CST))
+    {
+        struct timespec tick = {0, 10 * 1000000};
+        nanosleep (&tick, NULL);
+        elapsed += 10;
+        if (elapsed < btc->FollowInterval)
+            continue;
+        elapsed = 0;
+        try
+        {
+            btc->refresh ();
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << e.what () << std::endl;
+            return NULL;
+        }
+    }
+    return NULL;
+}
+
+// tail-follows the csv in the background: every intervalMs it checks the
+// file size and refresh ()es when it grew. in flight batches finish on the
+// table they started with.
+void BitcoinExchange::follow (unsigned intervalMs)
+{
+    if (Following)
+        return;
+    FollowInterval = intervalMs;
+    StopFollowing = false;
+    if (pthread_create (&Follower, NULL, &BitcoinExchange::followLoop, this) != 0)
+        throw std::runtime_error ("Error: could not start follower thread");
+    Following = true;
+}
+
+void BitcoinExchange::stopFollowing ()
+{
+    if (!Following)
+        return;
+    __atomic_store_n (&StopFollowing, true, __ATOMIC_SEQ_CST);
+    pthread_join (Follower, NULL);
+    Following = false;
+}
+
+// `from .. to`, both dates required and in order. unlike a `date | value`
+// line a bad date here is only a bad input, ranges are new and don't owe
+// anything to the old abort on unreadable dates.
+static bool scanRange (const char *begin, const char *end, const char *dots, int &from, int &to)
+{
+    const char *fromEnd = dots;
+    const char *toBegin = dots + 2;
+    while (fromEnd > begin && (fromEnd[-1] == ' ' || fromEnd[-1] == '\t'))
+        fromEnd--;
+    while (toBegin < end && (*toBegin == ' ' || *toBegin == '\t'))
+        toBegin++;
+    try
+    {
+        from = scanDate (begin, fromEnd);
+        to = scanDate (toBegin, end);
+    }
+    catch (const std::exception &)
+    {
+        return false;
+    }
+    return from <= to;
+}
+
+static void trimWhiteSpaces (const char *str, size_t len, size_t &begin, size_t &end)
+{
+    begin = 0;
+    end = len;
+    while (begin < end && (str[begin] == ' ' || str[begin] == '\t'))
+        begin++;
+    while (end > begin && (str[end - 1] == ' ' || str[end - 1] == '\t'))
+        end--;
+}
+
+// classifies queries[0, n), whose text and end must be set. a date that
+// can't be parsed aborts the whole run like it always did, but only after
+// the lines before it are answered, so the message is kept in batch.error
+// and parsing stops there. returns the number of lines that were parsed.
+// the dates of the block are checked as one column by scanDates first.
+size_t BitcoinExchange::parseBatch (Batch &batch, size_t n, bool first) const
+{
+    batch.days.clear ();
+    batch.dateBegins.clear ();
+    batch.dateEnds.clear ();
+    for (size_t i = 0; i < n; i++)
+    {
+        Query &q = batch.queries[i];
+        const char *text = q.text;
+        trimWhiteSpaces (text, q.end, q.begin, q.end);
+
+        if (first && i == 0)
         {
-            if (line != "date | value")
+            if (q.end - q.begin != 12 || memcmp (text + q.begin, "date | value", 12) != 0)
                 throw std::runtime_error ("Error: invalid header");
+            q.kind = Query::Header;
+            continue;
+        }
+        const char *pipe = static_cast<const char *> (memchr (text + q.begin, '|', q.end - q.begin));
+        if (!pipe)
+        {
+            const char *dots = static_cast<const char *> (memchr (text + q.begin, '.', q.end - q.begin));
+            if (dots && dots + 1 < text + q.end && dots[1] == '.'
+                && scanRange (text + q.begin, text + q.end, dots, q.day, q.to))
+                q.kind = Query::Range;
+            else
+                q.kind = Query::BadInput;
             continue;
         }
-        size_t pos = line.find ("|");
-        if (pos != std::string::npos)
+        // with a RateStore loaded, date | asset | value goes to the asset's
+        // own table
+        q.pipe = pipe - text;
+        q.kind = Query::Value;
+        q.asset = -1;
+        batch.dateBegins.push_back (text + q.begin);
+        batch.dateEnds.push_back (pipe);
+        const char *second = static_cast<const char *> (memchr (pipe + 1, '|', text + q.end - pipe - 1));
+        if (second && Assets)
         {
-            std::string date = line.substr (0, pos);
-            std::string valueStr = line.substr (pos + 1);
-            parseDate (date);
+            size_t from, to;
+            trimWhiteSpaces (pipe + 1, second - pipe - 1, from, to);
+            q.asset = Assets->id (pipe + 1 + from, to - from);
+            if (q.asset < 0)
+                q.kind = Query::UnknownAsset;
+            q.pipe = second - text;
+        }
+    }
+
+    size_t dates = batch.dateBegins.size ();
+    batch.keys.resize (dates);
+    batch.plain.resize (dates);
+    if (dates)
+        scanDates (&batch.dateBegins[0], &batch.dateEnds[0], dates, &batch.keys[0], &batch.plain[0]);
 
-            std::stringstream ss (valueStr);
-            double value;
-            if (!(ss >> value) || !(ss >> std::ws).eof() || value < 0)
+    size_t field = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        Query &q = batch.queries[i];
+        if (q.kind != Query::Value && q.kind != Query::UnknownAsset)
+            continue;
+        const char *text = q.text;
+        const char *pipe = text + q.pipe;
+        if (batch.plain[field])
+            q.day = batch.keys[field];
+        else
+        {
+            try
             {
-                std::cout << "Error: not a positive number." << std::endl;
-                continue;
+                q.day = scanDate (text + q.begin, batch.dateEnds[field]);
             }
-            if (value > 1000)
+            catch (const std::exception &e)
             {
-                std::cout << "Error: too large a number." << std::endl;
-                continue;
+                batch.error = e.what ();
+                return i;
             }
-            
-            std::map<std::string, double>::iterator it = DateValue.lower_bound (date);
-            if ((it != DateValue.end () && it->first == date))
-                std::cout << date << " => " << value << " = " << value * it->second << std::endl;
-            else
+        }
+        field++;
+        if (q.kind == Query::UnknownAsset)
+            continue;
+        if (!scanNumber (pipe + 1, text + q.end, q.value) || q.value < 0)
+            q.kind = Query::NotPositive;
+        else if (q.value > 1000)
+            q.kind = Query::TooLarge;
+        else if (q.asset < 0)
+        {
+            q.rate = batch.days.size ();
+            batch.days.push_back (q.day);
+        }
+    }
+    return n;
+}
+
+// answers every Value line of the block with one pass over the rate table,
+// then prints the block in input order.
+void BitcoinExchange::answerBatch (Batch &batch, size_t n, OutputSink &out) const
+{
+    Version *version = acquire ();
+    const RateTable &table = *version->table;
+    batch.rates.resize (batch.days.size ());
+    if (!batch.days.empty ())
+        table.findBatch (&batch.days[0], batch.days.size (), &batch.rates[0], batch.order);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        const Query &q = batch.queries[i];
+        switch (q.kind)
+        {
+            case Query::Header:
+                break;
+            case Query::BadInput:
+                out.write ("Error: bad input => ");
+                out.write (q.text + q.begin, q.end - q.begin);
+                out.newline ();
+                break;
+            case Query::NotPositive:
+                out.write ("Error: not a positive number.");
+                out.newline ();
+                break;
+            case Query::TooLarge:
+                out.write ("Error: too large a number.");
+                out.newline ();
+                break;
+            case Query::UnknownAsset:
             {
-                if (it != DateValue.begin())
-                    --it;
+                const char *pipe = static_cast<const char *> (memchr (q.text + q.begin, '|', q.pipe - q.begin));
+                size_t from, to;
+                trimWhiteSpaces (pipe + 1, q.text + q.pipe - pipe - 1, from, to);
+                out.write ("Error: unknown asset => ");
+                out.write (pipe + 1 + from, to - from);
+                out.newline ();
+                break;
+            }
+            case Query::Value:
+            {
+                double rate;
+                bool found;
+                if (q.asset < 0)
+                    found = table.rateAt (q.day, batch.rates[q.rate], Policy, rate);
                 else
                 {
-                    std::cout << "Error: no exchange rate available for this date" << std::endl;
-                    continue;
+                    const RateTable &asset = Assets->table (q.asset);
+                    found = asset.rateAt (q.day, asset.find (q.day), Policy, rate);
+                }
+                if (!found)
+                {
+                    out.write ("Error: no exchange rate available for this date");
+                    out.newline ();
+                    break;
                 }
-                std::cout << date << " => " << value << " = " << value * it->second << std::endl;
+                out.write (q.text + q.begin, q.pipe - q.begin);
+                out.write (" => ", 4);
+                out.putNumber (q.value);
+                out.write (" = ", 3);
+                out.putNumber (q.value * rate);
+                out.newline ();
+                break;
             }
+            case Query::Range:
+            {
+                RateTable::Range range;
+                if (!table.range (q.day, q.to, range))
+                {
+                    out.write ("Error: no exchange rate available for this range");
+                    out.newline ();
+                    break;
+                }
+                out.write (q.text + q.begin, q.end - q.begin);
+                out.write (" => min ", 8);
+                out.putNumber (range.min);
+                out.write (", max ", 6);
+                out.putNumber (range.max);
+                out.write (", mean ", 7);
+                out.putNumber (range.mean);
+                out.write (", twap ", 7);
+                out.putNumber (range.twap);
+                out.newline ();
+                break;
+            }
+        }
+    }
+    release (version);
+}
 
+// aggregates of the rates dated between two YYYY-MM-DD dates, inclusive.
+// false if there are none, throws on a date that can't be read.
+bool BitcoinExchange::range (const std::string &from, const std::string &to,
+    RateTable::Range &out) const
+{
+    const char *f = from.data ();
+    const char *t = to.data ();
+    int first = scanDate (f, f + from.size ());
+    int last = scanDate (t, t + to.size ());
+    Version *version = acquire ();
+    bool found = version->table->range (first, last, out);
+    release (version);
+    return found;
+}
+
+// answers every line in [begin, end), a block at a time. first says the
+// range starts with the header line. an unparsable date stops the range
+// with an exception, unless lenient is set: then its message is written
+// as the answer for that line and the range goes on.
+void BitcoinExchange::answerRange (const char *begin, const char *end, bool first, bool lenient,
+    OutputSink &out, Batch &batch) const
+{
+    const char *cur = begin;
+    while (cur < end)
+    {
+        size_t n = 0;
+        while (n < BatchSize && cur < end)
+        {
+            const char *nl = static_cast<const char *> (memchr (cur, '\n', end - cur));
+            if (!nl)
+                nl = end;
+            if (n == batch.queries.size ())
+                batch.queries.push_back (Query ());
+            batch.queries[n].text = cur;
+            batch.queries[n].end = nl - cur;
+            n++;
+            cur = nl + 1;
+        }
+        size_t parsed = parseBatch (batch, n, first);
+        answerBatch (batch, parsed, out);
+        if (parsed < n)
+        {
+            if (!lenient)
+                throw std::runtime_error (batch.error);
+            out.write (batch.error);
+            out.newline ();
+            if (parsed + 1 < n)
+                cur = batch.queries[parsed + 1].text;
+        }
+        first = false;
+    }
+}
+
+// answers a run of `date | value` lines (no header) the way printall would,
+// except that a bad date only fails its own line. used for requests coming
+// from clients, see Server. batch is kept by the caller, so a short request
+// doesn't pay for setting one up.
+void BitcoinExchange::answerLines (const char *begin, const char *end, OutputSink &out, Batch &batch) const
+{
+    answerRange (begin, end, false, true, out, batch);
+}
+
+void BitcoinExchange::printall (const std::string &inputFile)
+{
+    int fd = open (inputFile.c_str (), O_RDONLY);
+    struct stat st;
+    if (fd >= 0 && (fstat (fd, &st) < 0 || S_ISDIR (st.st_mode)))
+    {
+        close (fd);
+        fd = -1;
+    }
+    if (fd < 0)
+        throw std::runtime_error ("Error: could not open file");
+    try
+    {
+        printall (fd);
+    }
+    catch (...)
+    {
+        close (fd);
+        throw;
+    }
+    close (fd);
+}
+
+// the input is read through a LineReader, so a pipe or a terminal works
+// as well as a file and memory doesn't grow with the input. whatever whole
+// lines it holds are answered BatchSize lines at a time, each block's
+// dates resolved together by findBatch instead of one search per line.
+// the answers so far are flushed before waiting on the input again. a
+// line too long for the reader is answered with an error, like a client's.
+void BitcoinExchange::printall (int fd)
+{
+    LineReader in (fd);
+    OutputSink out (STDOUT_FILENO);
+    Batch batch;
+    bool first = true;
+    while (true)
+    {
+        out.flush ();
+        if (!in.fill ())
+            break;
+        if (in.cut () && first)
+            throw std::runtime_error ("Error: invalid header");
+        if (in.cut ())
+        {
+            out.write ("Error: line too long");
+            out.newline ();
         }
         else
-            std::cout << "Error: bad input => " << line << std::endl;
+            answerRange (in.begin (), in.end (), first, false, out, batch);
+        first = false;
+        in.consume ();
     }
+    if (first)
+        throw std::runtime_error ("Error: empty file");
+}
 
-    if (i == 0)
+// one job per chunk of the mapped input, chunks always end on a newline.
+class BitcoinExchange::ChunkJob : public WorkerPool::Job
+{
+    private:
+        const BitcoinExchange       &Exchange;
+        const std::vector<const char *> &Bounds;
+    public:
+        ChunkJob (const BitcoinExchange &exchange, const std::vector<const char *> &bounds)
+            : Exchange (exchange), Bounds (bounds) {}
+
+        void run (size_t index, std::string &out)
+        {
+            OutputSink sink;
+            Batch batch;
+            try
+            {
+                Exchange.answerRange (Bounds[index], Bounds[index + 1], index == 0, false, sink, batch);
+            }
+            catch (...)
+            {
+                sink.take (out);
+                throw;
+            }
+            sink.take (out);
+        }
+};
+
+// same output as printall, but the mapped input is cut into chunks at
+// newlines and the chunks are answered by threads workers against the
+// shared table. the pool writes the chunks back in order, so the output
+// is byte for byte the sequential one. inputs that can't be mapped (pipes,
+// devices) go through printall. threads is capped at ThreadsPerCpu per cpu
+// and at one per chunk.
+void BitcoinExchange::printall (const std::string &inputFile, size_t threads)
+{
+    MappedFile file;
+    size_t most = WorkerPool::defaultThreads () * ThreadsPerCpu;
+    if (threads > most)
+        threads = most;
+    if (threads <= 1 || !file.open (inputFile))
+    {
+        printall (inputFile);
+        return;
+    }
+    if (file.size () == 0)
         throw std::runtime_error ("Error: empty file");
-    if (file.eof ())
-        file.close ();
-     else
-        throw std::runtime_error ("Error: could not read file");
-}
\ No newline at end of file
+
+    const char *begin = file.data ();
+    const char *end = begin + file.size ();
+    size_t chunkSize = file.size () / (threads * 8);
+    if (chunkSize < MinChunkSize)
+        chunkSize = MinChunkSize;
+
+    std::vector<const char *> bounds (1, begin);
+    while (bounds.back () < end)
+    {
+        const char *cut = bounds.back () + chunkSize;
+        if (cut >= end)
+            cut = end;
+        else
+        {
+            const char *nl = static_cast<const char *> (memchr (cut, '\n', end - cut));
+            cut = nl ? nl + 1 : end;
+        }
+        bounds.push_back (cut);
+    }
+
+    if (threads > bounds.size () - 1)
+        threads = bounds.size () - 1;
+    ChunkJob job (*this, bounds);
+    WorkerPool pool (threads, threads * 4);
+    OutputSink out (STDOUT_FILENO);
+    pool.run (job, bounds.size () - 1, out);
+}
@@ -1,17 +1,65 @@
 #pragma once
 
 #include <iostream>
-#include <map>
 #include <fstream>
 #include <sstream>
 #include <string>
 #include <iomanip>
+#include <cstring>
+#include <cstdio>
+#include <vector>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+#include "RateTable.hpp"
+#include "RateStore.hpp"
+#include "MappedFile.hpp"
+#include "Scan.hpp"
+#include "WorkerPool.hpp"
+#include "OutputSink.hpp"
+#include "LineReader.hpp"
 
 class BitcoinExchange
 {
     private:
-        std::map<std::string, double> DateValue;
-        void parse(const std::string &fileName);
+        struct Query;
+        struct Version;
+        class ChunkJob;
+        static const size_t BatchSize = 4096;
+        static const size_t MinChunkSize = 1 << 20;
+        static const size_t ThreadsPerCpu = 4;
+
+        Version             *Current;
+        mutable int         Entering[2];
+        unsigned            Epoch;
+        RateTable::Lookup   Policy;
+        RateStore           *Assets;
+
+        std::string         FileName;
+        off_t               Offset;
+        ino_t               Inode;
+        pthread_mutex_t     ReloadLock;
+        pthread_t           Follower;
+        bool                Following;
+        bool                StopFollowing;
+        unsigned            FollowInterval;
+
+        void init ();
+        void parse (const std::string &fileName);
+        void reload (const std::string &fileName);
+        Version *acquire () const;
+        void release (Version *version) const;
+        void publish (RateTable *table);
+        static void *followLoop (void *self);
+
+    public:
+        struct Batch;
+    private:
+        size_t parseBatch (Batch &batch, size_t n, bool first) const;
+        void answerBatch (Batch &batch, size_t n, OutputSink &out) const;
+        void answerRange (const char *begin, const char *end, bool first, bool lenient,
+            OutputSink &out, Batch &batch) const;
     public:
         BitcoinExchange ();
         BitcoinExchange (const std::string &fileName);
@@ -19,6 +67,58 @@ class BitcoinExchange
         BitcoinExchange &operator= (const BitcoinExchange &obj);
         ~BitcoinExchange ();
 
+        void setLookup (RateTable::Lookup policy);
+        void loadAssets (const std::string &fileName);
+        bool refresh ();
+        void follow (unsigned intervalMs);
+        void stopFollowing ();
+
         void printall(const std::string &inputFile);
+        void printall (int fd);
+        void printall(const std::string &inputFile, size_t threads);
+        void answerLines (const char *begin, const char *end, OutputSink &out, Batch &batch) const;
+        bool range (const std::string &from, const std::string &to, RateTable::Range &out) const;
 
-};
\ No newline at end of file
+};
+
+// a published table and the readers holding it, the current pointer
+// counting as one. the last release () frees it.
+struct BitcoinExchange::Version
+{
+    RateTable   *table;
+    int         refs;
+};
+
+// what a single input line turned into, filled in two passes: parseBatch
+// reads the line, answerBatch looks its rate up with the rest of the block.
+struct BitcoinExchange::Query
+{
+    enum Kind { Header, BadInput, NotPositive, TooLarge, Value, Range, UnknownAsset };
+
+    const char  *text;
+    size_t      begin;
+    size_t      end;
+    size_t      pipe;
+    Kind        kind;
+    int         day;
+    int         to;
+    int         asset;
+    double      value;
+    long        rate;
+};
+
+// scratch space for one block of lines, reused from block to block and,
+// when the caller keeps it, from call to call. queries grows to the
+// longest block seen, at most BatchSize lines.
+struct BitcoinExchange::Batch
+{
+    std::vector<Query>          queries;
+    std::vector<const char *>   dateBegins;
+    std::vector<const char *>   dateEnds;
+    std::vector<int>            keys;
+    std::vector<unsigned char>  plain;
+    std::vector<int>            days;
+    std::vector<long>           rates;
+    std::vector<size_t>         order;
+    std::string                 error;
+};
@@ -0,0 +1,101 @@
+#include "LineReader.hpp"
+
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#include <unistd.h>
+
+LineReader::LineReader (int fd)
+    : Fd (fd), Buffer (new char[Capacity]), Length (0), Lines (0), Scanned (0), Eof (false), Skipping (false), Cut (false)
+{
+}
+
+LineReader::~LineReader ()
+{
+    delete[] Buffer;
+}
+
+// one read (2) into the free end of the buffer, dropping what is left of a
+// cut line as it comes in. false at the end of the input.
+bool LineReader::readMore ()
+{
+    ssize_t n;
+    do
+        n = ::read (Fd, Buffer + Length, Capacity - Length);
+    while (n < 0 && errno == EINTR);
+    if (n < 0)
+        throw std::runtime_error ("Error: could not read file");
+    if (n == 0)
+    {
+        Eof = true;
+        return false;
+    }
+    Length += n;
+    if (Skipping)
+    {
+        char *nl = static_cast<char *> (memchr (Buffer, '\n', Length));
+        size_t drop = nl ? nl + 1 - Buffer : Length;
+        memmove (Buffer, Buffer + drop, Length - drop);
+        Length -= drop;
+        Skipping = !nl;
+    }
+    return true;
+}
+
+// blocks only until there is at least one whole line (or the last one,
+// without its newline, at the end of the input): answers go out as soon as
+// their line is in, however slowly it was written. false once the input is
+// exhausted.
+bool LineReader::fill ()
+{
+    Cut = false;
+    while (true)
+    {
+        for (size_t i = Length; i > Scanned; i--)
+            if (Buffer[i - 1] == '\n')
+            {
+                Lines = i;
+                return true;
+            }
+        Scanned = Length;
+
+        if (Eof)
+        {
+            Lines = Length;
+            return Lines > 0;
+        }
+        if (Length == Capacity)
+        {
+            Length = 0;
+            Scanned = 0;
+            Skipping = true;
+            Cut = true;
+            return true;
+        }
+        readMore ();
+    }
+}
+
+void LineReader::consume ()
+{
+    memmove (Buffer, Buffer + Lines, Length - Lines);
+    Length -= Lines;
+    Lines = 0;
+    Scanned = 0;
+}
+
+// the last fill () stands for a line too long to keep, begin () == end ()
+bool LineReader::cut () const
+{
+    return Cut;
+}
+
+const char *LineReader::begin () const
+{
+    return Buffer;
+}
+
+const char *LineReader::end () const
+{
+    return Buffer + Lines;
+}
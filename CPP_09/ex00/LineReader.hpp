@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+
+// reads an fd of any length through one fixed buffer. fill () makes the
+// whole lines read so far available as [begin (), end ()), consume () gives
+// their space back and the unfinished line behind them moves to the front,
+// so memory stays at Capacity whatever the input size. a line that can't
+// fit is never handed out in part: it is skipped to its newline and fill ()
+// returns an empty range with cut () set in its place.
+class LineReader
+{
+    private:
+        static const size_t Capacity = 1 << 20;
+
+        int     Fd;
+        char    *Buffer;
+        size_t  Length;
+        size_t  Lines;
+        size_t  Scanned;
+        bool    Eof;
+        bool    Skipping;
+        bool    Cut;
+
+        LineReader (const LineReader &other);
+        LineReader &operator= (const LineReader &obj);
+
+        bool readMore ();
+    public:
+        LineReader (int fd);
+        ~LineReader ();
+
+        bool fill ();
+        void consume ();
+        bool cut () const;
+
+        const char *begin () const;
+        const char *end () const;
+};
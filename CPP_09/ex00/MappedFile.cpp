@@ -0,0 +1,67 @@
+#include "MappedFile.hpp"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+MappedFile::MappedFile () : Data (NULL), Size (0)
+{
+}
+
+MappedFile::MappedFile (const std::string &fileName) : Data (NULL), Size (0)
+{
+    open (fileName);
+}
+
+MappedFile::~MappedFile ()
+{
+    close ();
+}
+
+bool MappedFile::open (const std::string &fileName)
+{
+    close ();
+    int fd = ::open (fileName.c_str (), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat (fd, &st) < 0 || !S_ISREG (st.st_mode))
+    {
+        ::close (fd);
+        return false;
+    }
+    // an empty file is valid but can't be mapped, Data stays NULL.
+    if (st.st_size > 0)
+    {
+        void *p = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED)
+        {
+            ::close (fd);
+            return false;
+        }
+        madvise (p, st.st_size, MADV_SEQUENTIAL);
+        Data = static_cast<const char *> (p);
+        Size = st.st_size;
+    }
+    ::close (fd);
+    return true;
+}
+
+void MappedFile::close ()
+{
+    if (Data)
+        munmap (const_cast<char *> (Data), Size);
+    Data = NULL;
+    Size = 0;
+}
+
+const char *MappedFile::data () const
+{
+    return Data;
+}
+
+size_t MappedFile::size () const
+{
+    return Size;
+}
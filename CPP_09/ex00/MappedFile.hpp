@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+// read-only mmap of a whole file, unmapped in the destructor.
+class MappedFile
+{
+    private:
+        const char  *Data;
+        size_t      Size;
+
+        MappedFile (const MappedFile &other);
+        MappedFile &operator= (const MappedFile &obj);
+    public:
+        MappedFile ();
+        MappedFile (const std::string &fileName);
+        ~MappedFile ();
+
+        bool open (const std::string &fileName);
+        void close ();
+
+        const char *data () const;
+        size_t size () const;
+};
@@ -0,0 +1,214 @@
+#include "OutputSink.hpp"
+
+#include <cstring>
+#include <cstdio>
+#include <cmath>
+#include <cerrno>
+#include <unistd.h>
+#include <stdint.h>
+
+OutputSink::OutputSink ()
+    : Fd (-1), LineBuffered (false), Failed (false), Length (0), Buffer (new char[Capacity]), Target (NULL)
+{
+}
+
+OutputSink::OutputSink (int fd)
+    : Fd (fd), LineBuffered (isatty (fd)), Failed (false), Length (0), Buffer (new char[Capacity]), Target (NULL)
+{
+}
+
+OutputSink::OutputSink (int fd, bool lineBuffered)
+    : Fd (fd), LineBuffered (lineBuffered), Failed (false), Length (0), Buffer (new char[Capacity]), Target (NULL)
+{
+}
+
+OutputSink::OutputSink (std::string &target)
+    : Fd (-1), LineBuffered (false), Failed (false), Length (0), Buffer (NULL), Target (&target)
+{
+}
+
+OutputSink::~OutputSink ()
+{
+    flush ();
+    delete[] Buffer;
+}
+
+// a failed write (closed pipe, full disk) drops the rest of the output
+// quietly, like a stream with badbit set.
+void OutputSink::drain (const char *data, size_t len)
+{
+    if (Fd < 0)
+    {
+        Memory.append (data, len);
+        return;
+    }
+    while (len > 0 && !Failed)
+    {
+        ssize_t n = ::write (Fd, data, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+        {
+            Failed = true;
+            break;
+        }
+        data += n;
+        len -= n;
+    }
+}
+
+void OutputSink::flush ()
+{
+    if (Length > 0)
+        drain (Buffer, Length);
+    Length = 0;
+}
+
+void OutputSink::write (const char *data, size_t len)
+{
+    if (Target)
+    {
+        Target->append (data, len);
+        return;
+    }
+    if (Length + len > Capacity)
+    {
+        flush ();
+        if (len >= Capacity)
+        {
+            drain (data, len);
+            return;
+        }
+    }
+    memcpy (Buffer + Length, data, len);
+    Length += len;
+}
+
+void OutputSink::write (const char *str)
+{
+    write (str, strlen (str));
+}
+
+void OutputSink::write (const std::string &str)
+{
+    write (str.data (), str.size ());
+}
+
+void OutputSink::put (char c)
+{
+    if (Target)
+    {
+        Target->push_back (c);
+        return;
+    }
+    if (Length == Capacity)
+        flush ();
+    Buffer[Length++] = c;
+}
+
+void OutputSink::newline ()
+{
+    put ('\n');
+    if (LineBuffered)
+        flush ();
+}
+
+void OutputSink::putNumber (double value)
+{
+    char buf[32];
+    write (buf, formatNumber (buf, value));
+}
+
+void OutputSink::take (std::string &out)
+{
+    flush ();
+    out.swap (Memory);
+    Memory.clear ();
+}
+
+// the text `std::cout << value` gives with default flags, i.e. printf's
+// %g with 6 significant digits. the usual range is done by hand: scale to
+// a 6 digit integer, round, and place the point. when the scaled value is
+// too close to a rounding tie for the scaling error to be ruled out, or
+// for zero, huge, tiny and non finite values, snprintf does it.
+size_t OutputSink::formatNumber (char *buf, double value)
+{
+    static const double pow10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    double x = value < 0 ? -value : value;
+    if (!(x >= 1e-5 && x < 1e16))
+        return snprintf (buf, 32, "%g", value);
+
+    // x in [10^exp, 10^(exp + 1))
+    int exp = 0;
+    while (exp < 15 && x >= pow10[exp + 1])
+        exp++;
+    while (exp > -5 && x < (exp >= 0 ? pow10[exp] : 1.0 / pow10[-exp]))
+        exp--;
+
+    double scaled = exp <= 5 ? x * pow10[5 - exp] : x / pow10[exp - 5];
+    double whole = std::floor (scaled);
+    double frac = scaled - whole;
+    if (std::fabs (frac - 0.5) < 1e-7)
+        return snprintf (buf, 32, "%g", value);
+    uint32_t digits = static_cast<uint32_t> (whole) + (frac > 0.5);
+    if (digits >= 1000000)
+    {
+        digits /= 10;
+        exp++;
+    }
+
+    char d[6];
+    for (int i = 5; i >= 0; i--)
+    {
+        d[i] = '0' + digits % 10;
+        digits /= 10;
+    }
+    int last = 5;
+    while (last > 0 && d[last] == '0')
+        last--;
+
+    size_t len = 0;
+    if (value < 0)
+        buf[len++] = '-';
+    if (exp < -4 || exp >= 6)
+    {
+        buf[len++] = d[0];
+        if (last > 0)
+        {
+            buf[len++] = '.';
+            for (int i = 1; i <= last; i++)
+                buf[len++] = d[i];
+        }
+        buf[len++] = 'e';
+        buf[len++] = exp < 0 ? '-' : '+';
+        int e = exp < 0 ? -exp : exp;
+        buf[len++] = '0' + e / 10;
+        buf[len++] = '0' + e % 10;
+    }
+    else if (exp >= 0)
+    {
+        for (int i = 0; i <= exp; i++)
+            buf[len++] = d[i];
+        if (last > exp)
+        {
+            buf[len++] = '.';
+            for (int i = exp + 1; i <= last; i++)
+                buf[len++] = d[i];
+        }
+    }
+    else
+    {
+        buf[len++] = '0';
+        buf[len++] = '.';
+        for (int i = -1; i > exp; i--)
+            buf[len++] = '0';
+        for (int i = 0; i <= last; i++)
+            buf[len++] = d[i];
+    }
+    buf[len] = '\0';
+    return len;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+// buffered writer for the answers. bytes collect in a big user space buffer
+// and go out in one write (2) when it fills up, on flush () and in the
+// destructor. a line buffered sink (the default when fd is a terminal) also
+// flushes at every newline (). without an fd the sink collects everything
+// in memory, see take (). given a string, it appends straight to it and
+// has no buffer of its own, so it costs nothing to set up.
+class OutputSink
+{
+    private:
+        static const size_t Capacity = 1 << 16;
+
+        int         Fd;
+        bool        LineBuffered;
+        bool        Failed;
+        size_t      Length;
+        char        *Buffer;
+        std::string Memory;
+        std::string *Target;
+
+        OutputSink (const OutputSink &other);
+        OutputSink &operator= (const OutputSink &obj);
+
+        void drain (const char *data, size_t len);
+    public:
+        OutputSink ();
+        OutputSink (int fd);
+        OutputSink (int fd, bool lineBuffered);
+        OutputSink (std::string &target);
+        ~OutputSink ();
+
+        void write (const char *data, size_t len);
+        void write (const char *str);
+        void write (const std::string &str);
+        void put (char c);
+        void putNumber (double value);
+        void newline ();
+        void flush ();
+        void take (std::string &out);
+
+        static size_t formatNumber (char *buf, double value);
+};
@@ -0,0 +1,70 @@
+#include "RangeIndex.hpp"
+
+#include <algorithm>
+
+// Held[i] is the rate * days total of the history up to date i: every
+// rate counted for each day it stayed the last known one.
+RangeIndex::RangeIndex (const int *dates, const double *rates, size_t n)
+    : N (n), Prefix (n + 1), Held (n), MinTree (2 * n), MaxTree (2 * n)
+{
+    Prefix[0] = 0;
+    for (size_t i = 0; i < n; i++)
+        Prefix[i + 1] = Prefix[i] + rates[i];
+    if (n > 0)
+        Held[0] = 0;
+    for (size_t i = 1; i < n; i++)
+        Held[i] = Held[i - 1] + rates[i - 1] * (dates[i] - dates[i - 1]);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        MinTree[n + i] = rates[i];
+        MaxTree[n + i] = rates[i];
+    }
+    for (size_t i = n - 1; i > 0 && n > 0; i--)
+    {
+        MinTree[i] = std::min (MinTree[2 * i], MinTree[2 * i + 1]);
+        MaxTree[i] = std::max (MaxTree[2 * i], MaxTree[2 * i + 1]);
+    }
+}
+
+RangeIndex::~RangeIndex ()
+{
+}
+
+// rates[lo] + ... + rates[hi]
+double RangeIndex::sum (size_t lo, size_t hi) const
+{
+    return Prefix[hi + 1] - Prefix[lo];
+}
+
+double RangeIndex::held (size_t i) const
+{
+    return Held[i];
+}
+
+// the trees are queried on the half open leaf range [lo + N, hi + N + 1)
+double RangeIndex::min (size_t lo, size_t hi) const
+{
+    double result = MinTree[lo + N];
+    for (size_t l = lo + N, r = hi + N + 1; l < r; l /= 2, r /= 2)
+    {
+        if (l & 1)
+            result = std::min (result, MinTree[l++]);
+        if (r & 1)
+            result = std::min (result, MinTree[--r]);
+    }
+    return result;
+}
+
+double RangeIndex::max (size_t lo, size_t hi) const
+{
+    double result = MaxTree[lo + N];
+    for (size_t l = lo + N, r = hi + N + 1; l < r; l /= 2, r /= 2)
+    {
+        if (l & 1)
+            result = std::max (result, MaxTree[l++]);
+        if (r & 1)
+            result = std::max (result, MaxTree[--r]);
+    }
+    return result;
+}
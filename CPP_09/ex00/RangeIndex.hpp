@@ -0,0 +1,26 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+// precomputed aggregates over a rate column for range queries:
+// prefix sums give the sum of any run of rates in O(1), and a bottom-up
+// segment tree per extreme gives its min and max in O(log n) with only 2n
+// doubles each (a sparse table would be O(1) but n log n doubles).
+class RangeIndex
+{
+    private:
+        size_t              N;
+        std::vector<double> Prefix;
+        std::vector<double> Held;
+        std::vector<double> MinTree;
+        std::vector<double> MaxTree;
+    public:
+        RangeIndex (const int *dates, const double *rates, size_t n);
+        ~RangeIndex ();
+
+        double sum (size_t lo, size_t hi) const;
+        double held (size_t i) const;
+        double min (size_t lo, size_t hi) const;
+        double max (size_t lo, size_t hi) const;
+};
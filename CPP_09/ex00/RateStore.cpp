@@ -0,0 +1,149 @@
+#include "RateStore.hpp"
+#include "Scan.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+RateStore::RateStore () : Slots (16, -1)
+{
+}
+
+RateStore::RateStore (const RateStore &other) : Slots (16, -1)
+{
+    *this = other;
+}
+
+RateStore &RateStore::operator= (const RateStore &obj)
+{
+    if (this != &obj)
+    {
+        clear ();
+        Names = obj.Names;
+        Slots = obj.Slots;
+        for (size_t i = 0; i < obj.Tables.size (); i++)
+            Tables.push_back (new RateTable (*obj.Tables[i]));
+    }
+    return *this;
+}
+
+RateStore::~RateStore ()
+{
+    clear ();
+}
+
+void RateStore::clear ()
+{
+    for (size_t i = 0; i < Tables.size (); i++)
+        delete Tables[i];
+    Tables.clear ();
+    Names.clear ();
+    Slots.assign (16, -1);
+}
+
+// fnv-1a, asset names are short
+size_t RateStore::hash (const char *name, size_t len)
+{
+    size_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++)
+        h = (h ^ static_cast<unsigned char> (name[i])) * 16777619u;
+    return h;
+}
+
+// the slot holding name, or the empty slot where it would go. Slots is a
+// power of two at most half full, so the probe always ends.
+size_t RateStore::slot (const char *name, size_t len) const
+{
+    size_t mask = Slots.size () - 1;
+    size_t i = hash (name, len) & mask;
+    while (Slots[i] >= 0)
+    {
+        const std::string &other = Names[Slots[i]];
+        if (other.size () == len && memcmp (other.data (), name, len) == 0)
+            break;
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+void RateStore::grow ()
+{
+    Slots.assign (Slots.size () * 2, -1);
+    for (size_t id = 0; id < Names.size (); id++)
+        Slots[slot (Names[id].data (), Names[id].size ())] = id;
+}
+
+// the id of name, a new one if it wasn't seen before.
+int RateStore::intern (const char *name, size_t len)
+{
+    size_t i = slot (name, len);
+    if (Slots[i] >= 0)
+        return Slots[i];
+    int id = Names.size ();
+    Names.push_back (std::string (name, len));
+    Tables.push_back (new RateTable);
+    Slots[i] = id;
+    if (Names.size () * 2 > Slots.size ())
+        grow ();
+    return id;
+}
+
+// -1 for an asset the store doesn't know.
+int RateStore::id (const char *name, size_t len) const
+{
+    return Slots[slot (name, len)];
+}
+
+// same rules as RateTable::loadCsv, with the asset between the date and
+// the rate. rows of an asset don't have to be next to each other.
+void RateStore::loadCsv (const char *data, size_t size)
+{
+    static const char header[] = "date,asset,exchange_rate";
+
+    const char *cur = data;
+    const char *end = data + size;
+    if (cur == end)
+        throw std::runtime_error ("Error: empty file");
+
+    bool first = true;
+    while (cur < end)
+    {
+        const char *nl = static_cast<const char *> (memchr (cur, '\n', end - cur));
+        if (!nl)
+            nl = end;
+        const char *line = cur;
+        cur = nl + 1;
+        if (first)
+        {
+            first = false;
+            if (static_cast<size_t> (nl - line) != sizeof (header) - 1 || memcmp (line, header, sizeof (header) - 1) != 0)
+                throw std::runtime_error ("Error: invalid header");
+            continue;
+        }
+        const char *comma = static_cast<const char *> (memchr (line, ',', nl - line));
+        const char *second = comma ? static_cast<const char *> (memchr (comma + 1, ',', nl - comma - 1)) : NULL;
+        if (!second || second == comma + 1)
+            throw std::runtime_error ("Error: invalid line format");
+        int day = scanDate (line, comma);
+        double value;
+        if (!scanNumber (second + 1, nl, value) || value < 0)
+            throw std::runtime_error ("Error: invalid value");
+        Tables[intern (comma + 1, second - comma - 1)]->add (day, value);
+    }
+    for (size_t i = 0; i < Tables.size (); i++)
+        Tables[i]->finalize ();
+}
+
+size_t RateStore::size () const
+{
+    return Names.size ();
+}
+
+const std::string &RateStore::name (int id) const
+{
+    return Names[id];
+}
+
+const RateTable &RateStore::table (int id) const
+{
+    return *Tables[id];
+}
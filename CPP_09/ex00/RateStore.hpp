@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstddef>
+
+#include "RateTable.hpp"
+
+// rate histories for many assets, read from a `date,asset,exchange_rate`
+// csv. asset names are interned to small ids through an open addressing
+// hash, and every asset gets a RateTable of its own: one sorted pair of
+// date and rate columns (and one Calendar) per asset, so a lookup only
+// ever touches its asset's columns, however many other assets there are.
+// the store is immutable once loaded, readers don't need any lock.
+class RateStore
+{
+    private:
+        std::vector<std::string>    Names;
+        std::vector<RateTable *>    Tables;
+        std::vector<int>            Slots;
+
+        static size_t hash (const char *name, size_t len);
+        size_t slot (const char *name, size_t len) const;
+        void grow ();
+        void clear ();
+    public:
+        RateStore ();
+        RateStore (const RateStore &other);
+        RateStore &operator= (const RateStore &obj);
+        ~RateStore ();
+
+        int intern (const char *name, size_t len);
+        int id (const char *name, size_t len) const;
+        void loadCsv (const char *data, size_t size);
+
+        size_t size () const;
+        const std::string &name (int id) const;
+        const RateTable &table (int id) const;
+};
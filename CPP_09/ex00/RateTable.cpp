@@ -0,0 +1,553 @@
+#include "RateTable.hpp"
+#include "Scan.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <cstdio>
+#include <stdexcept>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// on-disk snapshot: this header in the first page, then the dates column and
+// the rates column, each starting on a page boundary so they can be used
+// straight out of the mapping.
+struct SnapshotHeader
+{
+    char        magic[8];
+    uint32_t    version;
+    uint32_t    byteOrder;
+    uint64_t    count;
+    uint64_t    datesOffset;
+    uint64_t    ratesOffset;
+    uint64_t    sourceSize;
+    int64_t     sourceMtime;
+    int64_t     sourceMtimeNsec;
+    int64_t     sourceCtime;
+    int64_t     sourceCtimeNsec;
+    uint64_t    sourceInode;
+    uint64_t    dataChecksum;
+    uint64_t    headerChecksum;
+};
+
+static const char       snapshotMagic[8] = {'B', 'T', 'C', 'S', 'N', 'A', 'P', '\0'};
+static const uint32_t   snapshotVersion = 2;
+static const uint32_t   snapshotByteOrder = 0x01020304;
+static const uint64_t   snapshotPage = 4096;
+
+static uint64_t alignPage (uint64_t n)
+{
+    return (n + snapshotPage - 1) & ~(snapshotPage - 1);
+}
+
+// 64 bit multiply/xor hash, a word at a time with four independent lanes
+// so checking a snapshot costs about as much as reading it.
+static uint64_t checksum (const void *data, size_t len, uint64_t seed)
+{
+    const unsigned char *p = static_cast<const unsigned char *> (data);
+    const uint64_t prime = 0x100000001b3ULL;
+    uint64_t h[4] = {seed, seed ^ 0x9e3779b97f4a7c15ULL, seed ^ 0xc2b2ae3d27d4eb4fULL, seed ^ 0x165667b19e3779f9ULL};
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32)
+    {
+        for (int k = 0; k < 4; k++)
+        {
+            uint64_t w;
+            memcpy (&w, p + i + 8 * k, 8);
+            h[k] = (h[k] ^ w) * prime;
+        }
+    }
+    for (; i < len; i++)
+        h[0] = (h[0] ^ p[i]) * prime;
+    return (h[0] ^ (h[1] >> 7) ^ (h[2] << 11) ^ (h[3] >> 17)) * prime;
+}
+
+static uint64_t headerChecksum (const SnapshotHeader &header)
+{
+    return checksum (&header, offsetof (SnapshotHeader, headerChecksum), 0xcbf29ce484222325ULL);
+}
+
+RateTable::RateTable () : Snapshot (NULL), Dates (NULL), Rates (NULL), Count (0), Ranges (NULL)
+{
+    pthread_mutex_init (&RangesLock, NULL);
+}
+
+RateTable::RateTable (const RateTable &other)
+    : Snapshot (NULL), Dates (NULL), Rates (NULL), Count (0), Ranges (NULL)
+{
+    pthread_mutex_init (&RangesLock, NULL);
+    *this = other;
+}
+
+// copies always own their data, a snapshot mapping is never shared.
+RateTable &RateTable::operator= (const RateTable &obj)
+{
+    if (this != &obj)
+    {
+        std::vector<int> dates (obj.Dates, obj.Dates + obj.Count);
+        std::vector<double> rates (obj.Rates, obj.Rates + obj.Count);
+        OwnDates.swap (dates);
+        OwnRates.swap (rates);
+        delete Snapshot;
+        Snapshot = NULL;
+        attachOwn ();
+    }
+    return *this;
+}
+
+RateTable::~RateTable ()
+{
+    dropRanges ();
+    delete Snapshot;
+    pthread_mutex_destroy (&RangesLock);
+}
+
+void RateTable::attachOwn ()
+{
+    Count = OwnDates.size ();
+    Dates = Count ? &OwnDates[0] : NULL;
+    Rates = Count ? &OwnRates[0] : NULL;
+    buildCalendar ();
+    dropRanges ();
+}
+
+// Calendar[day - Dates[0]] is find (day) for every day of the history, so
+// a lookup is a subtraction and a load. a history spanning more than
+// MaxCalendar days (only possible with odd far off years) goes without
+// and find () falls back to the binary search.
+void RateTable::buildCalendar ()
+{
+    std::vector<int> ().swap (Calendar);
+    if (Count == 0 || static_cast<long long> (Dates[Count - 1]) - Dates[0] >= MaxCalendar)
+        return;
+    Calendar.resize (Dates[Count - 1] - Dates[0] + 1);
+    size_t i = 0;
+    for (size_t k = 0; k < Calendar.size (); k++)
+    {
+        int day = Dates[0] + static_cast<int> (k);
+        while (i + 1 < Count && Dates[i + 1] <= day)
+            i++;
+        Calendar[k] = static_cast<int> (i);
+    }
+}
+
+void RateTable::add (int day, double rate)
+{
+    OwnDates.push_back (day);
+    OwnRates.push_back (rate);
+}
+
+// one pass over the raw csv text: lines are cut with memchr and the fields
+// are scanned in place, nothing is allocated per line. rows are appended,
+// call finalize () once the whole file is in. withHeader is false for text
+// that continues a file whose header was already checked.
+void RateTable::loadCsv (const char *data, size_t size, bool withHeader)
+{
+    static const char header[] = "date,exchange_rate";
+
+    const char *cur = data;
+    const char *end = data + size;
+    if (cur == end && withHeader)
+        throw std::runtime_error ("Error: empty file");
+
+    // a csv row is rarely shorter than 16 bytes
+    OwnDates.reserve (OwnDates.size () + size / 16);
+    OwnRates.reserve (OwnRates.size () + size / 16);
+
+    if (withHeader)
+    {
+        const char *nl = static_cast<const char *> (memchr (cur, '\n', end - cur));
+        if (!nl)
+            nl = end;
+        if (static_cast<size_t> (nl - cur) != sizeof (header) - 1 || memcmp (cur, header, sizeof (header) - 1) != 0)
+            throw std::runtime_error ("Error: invalid header");
+        cur = nl + 1;
+    }
+
+    // rows go DateLanes at a time so their dates are checked together.
+    // a row without a comma ends its group early and throws once the rows
+    // before it are in, so errors still come out in file order.
+    const char *lines[DateLanes];
+    const char *commas[DateLanes];
+    const char *ends[DateLanes];
+    int days[DateLanes];
+    unsigned char plain[DateLanes];
+    while (cur < end)
+    {
+        size_t n = 0;
+        bool broken = false;
+        while (n < DateLanes && cur < end)
+        {
+            const char *nl = static_cast<const char *> (memchr (cur, '\n', end - cur));
+            if (!nl)
+                nl = end;
+            const char *comma = static_cast<const char *> (memchr (cur, ',', nl - cur));
+            if (!comma)
+            {
+                broken = true;
+                break;
+            }
+            lines[n] = cur;
+            commas[n] = comma;
+            ends[n] = nl;
+            n++;
+            cur = nl + 1;
+        }
+
+        scanDates (lines, commas, n, days, plain);
+        for (size_t i = 0; i < n; i++)
+        {
+            int day = plain[i] ? days[i] : scanDate (lines[i], commas[i]);
+            double value;
+            if (!scanNumber (commas[i] + 1, ends[i], value) || value < 0)
+                throw std::runtime_error ("Error: invalid value");
+            OwnDates.push_back (day);
+            OwnRates.push_back (value);
+        }
+        if (broken)
+            throw std::runtime_error ("Error: invalid line format");
+    }
+}
+
+// data.csv is normally already sorted, so the sort only runs when it isn't.
+// a repeated date keeps the last value seen, like map[date] = value did.
+void RateTable::finalize ()
+{
+    size_t n = OwnDates.size ();
+    bool sorted = true;
+    for (size_t i = 1; i < n && sorted; i++)
+        sorted = OwnDates[i - 1] <= OwnDates[i];
+
+    if (!sorted)
+    {
+        std::vector<std::pair<int, size_t> > order (n);
+        for (size_t i = 0; i < n; i++)
+            order[i] = std::make_pair (OwnDates[i], i);
+        std::sort (order.begin (), order.end ());
+        std::vector<double> rates (n);
+        for (size_t i = 0; i < n; i++)
+        {
+            OwnDates[i] = order[i].first;
+            rates[i] = OwnRates[order[i].second];
+        }
+        OwnRates.swap (rates);
+    }
+
+    size_t out = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        if (out > 0 && OwnDates[out - 1] == OwnDates[i])
+            out--;
+        OwnDates[out] = OwnDates[i];
+        OwnRates[out] = OwnRates[i];
+        out++;
+    }
+    OwnDates.resize (out);
+    OwnRates.resize (out);
+    std::vector<int> (OwnDates).swap (OwnDates);
+    std::vector<double> (OwnRates).swap (OwnRates);
+    delete Snapshot;
+    Snapshot = NULL;
+    attachOwn ();
+}
+
+// maps a snapshot written by writeSnapshot and uses its columns in place.
+// fails (and leaves the table alone) when the file is missing, damaged, from
+// another version, or was made from a different state of the source file.
+bool RateTable::loadSnapshot (const std::string &fileName, const struct stat &source)
+{
+    MappedFile *map = new MappedFile;
+    if (!map->open (fileName) || map->size () < snapshotPage)
+    {
+        delete map;
+        return false;
+    }
+    SnapshotHeader header;
+    memcpy (&header, map->data (), sizeof (header));
+    if (header.count > map->size ())
+    {
+        delete map;
+        return false;
+    }
+    uint64_t datesEnd = header.datesOffset + header.count * sizeof (int);
+    uint64_t ratesEnd = header.ratesOffset + header.count * sizeof (double);
+    if (memcmp (header.magic, snapshotMagic, sizeof (snapshotMagic)) != 0
+        || header.version != snapshotVersion
+        || header.byteOrder != snapshotByteOrder
+        || header.headerChecksum != headerChecksum (header)
+        || header.sourceSize != static_cast<uint64_t> (source.st_size)
+        || header.sourceMtime != static_cast<int64_t> (source.st_mtim.tv_sec)
+        || header.sourceMtimeNsec != static_cast<int64_t> (source.st_mtim.tv_nsec)
+        || header.sourceCtime != static_cast<int64_t> (source.st_ctim.tv_sec)
+        || header.sourceCtimeNsec != static_cast<int64_t> (source.st_ctim.tv_nsec)
+        || header.sourceInode != static_cast<uint64_t> (source.st_ino)
+        || header.datesOffset % snapshotPage != 0 || header.ratesOffset % snapshotPage != 0
+        || header.datesOffset < snapshotPage || header.ratesOffset < datesEnd
+        || ratesEnd > map->size ())
+    {
+        delete map;
+        return false;
+    }
+    const char *base = map->data ();
+    uint64_t sum = checksum (base + header.datesOffset, header.count * sizeof (int), header.count);
+    sum = checksum (base + header.ratesOffset, header.count * sizeof (double), sum);
+    if (sum != header.dataChecksum)
+    {
+        delete map;
+        return false;
+    }
+
+    std::vector<int> ().swap (OwnDates);
+    std::vector<double> ().swap (OwnRates);
+    delete Snapshot;
+    Snapshot = map;
+    Count = header.count;
+    Dates = Count ? reinterpret_cast<const int *> (base + header.datesOffset) : NULL;
+    Rates = Count ? reinterpret_cast<const double *> (base + header.ratesOffset) : NULL;
+    buildCalendar ();
+    dropRanges ();
+    return true;
+}
+
+// writes to a temporary file and renames it over the target, so a reader
+// never maps a half written snapshot.
+bool RateTable::writeSnapshot (const std::string &fileName, const struct stat &source) const
+{
+    SnapshotHeader header;
+    memset (&header, 0, sizeof (header));
+    memcpy (header.magic, snapshotMagic, sizeof (snapshotMagic));
+    header.version = snapshotVersion;
+    header.byteOrder = snapshotByteOrder;
+    header.count = Count;
+    header.datesOffset = snapshotPage;
+    header.ratesOffset = alignPage (header.datesOffset + Count * sizeof (int));
+    header.sourceSize = source.st_size;
+    header.sourceMtime = source.st_mtim.tv_sec;
+    header.sourceMtimeNsec = source.st_mtim.tv_nsec;
+    header.sourceCtime = source.st_ctim.tv_sec;
+    header.sourceCtimeNsec = source.st_ctim.tv_nsec;
+    header.sourceInode = source.st_ino;
+    header.dataChecksum = checksum (Dates, Count * sizeof (int), Count);
+    header.dataChecksum = checksum (Rates, Count * sizeof (double), header.dataChecksum);
+    header.headerChecksum = headerChecksum (header);
+
+    char suffix[32];
+    snprintf (suffix, sizeof (suffix), ".%ld.tmp", static_cast<long> (getpid ()));
+    std::string tmpName = fileName + suffix;
+    int fd = open (tmpName.c_str (), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return false;
+
+    std::vector<char> page (snapshotPage, 0);
+    memcpy (&page[0], &header, sizeof (header));
+    uint64_t ratesEnd = header.ratesOffset + Count * sizeof (double);
+    bool ok = pwrite (fd, &page[0], snapshotPage, 0) == static_cast<ssize_t> (snapshotPage)
+        && (Count == 0 || pwrite (fd, Dates, Count * sizeof (int), header.datesOffset) == static_cast<ssize_t> (Count * sizeof (int)))
+        && (Count == 0 || pwrite (fd, Rates, Count * sizeof (double), header.ratesOffset) == static_cast<ssize_t> (Count * sizeof (double)))
+        && ftruncate (fd, alignPage (ratesEnd)) == 0;
+    if (close (fd) < 0)
+        ok = false;
+    if (ok && rename (tmpName.c_str (), fileName.c_str ()) == 0)
+        return true;
+    unlink (tmpName.c_str ());
+    return false;
+}
+
+size_t RateTable::size () const
+{
+    return Count;
+}
+
+int RateTable::date (size_t i) const
+{
+    return Dates[i];
+}
+
+double RateTable::rate (size_t i) const
+{
+    return Rates[i];
+}
+
+// index of the last date <= day, or -1 if day is before the whole history.
+// without a calendar it is a binary search whose loop has no data dependent
+// branch: every step halves the window whatever the comparison says, the
+// comparison only picks the offset.
+long RateTable::find (int day) const
+{
+    if (!Calendar.empty ())
+    {
+        if (day < Dates[0])
+            return -1;
+        size_t k = static_cast<size_t> (static_cast<long long> (day) - Dates[0]);
+        return k < Calendar.size () ? Calendar[k] : static_cast<long> (Count) - 1;
+    }
+
+    size_t n = Count;
+    if (n == 0)
+        return -1;
+    const int *base = Dates;
+    size_t lo = 0;
+    while (n > 1)
+    {
+        size_t half = n / 2;
+        lo += (base[lo + half] <= day) * half;
+        n -= half;
+    }
+    return base[lo] <= day ? static_cast<long> (lo) : -1;
+}
+
+// find () for a whole block of days at once: out[i] = find (days[i]).
+// with the calendar that is a load per day. without it the days are
+// visited in ascending order (order is only sorted when the input isn't
+// already) and answered by one forward walk over the dates. the walk
+// gallops, so a small block against a big table still only touches
+// O(n log (size / n)) dates instead of all of them.
+void RateTable::findBatch (const int *days, size_t n, long *out, std::vector<size_t> &order) const
+{
+    if (!Calendar.empty ())
+    {
+        for (size_t i = 0; i < n; i++)
+            out[i] = find (days[i]);
+        return;
+    }
+
+    bool sorted = true;
+    for (size_t i = 1; i < n && sorted; i++)
+        sorted = days[i - 1] <= days[i];
+    order.resize (n);
+    for (size_t i = 0; i < n; i++)
+        order[i] = i;
+    if (!sorted)
+        std::sort (order.begin (), order.end (), DayOrder (days));
+
+    size_t j = 0;
+    for (size_t k = 0; k < n; k++)
+    {
+        int day = days[order[k]];
+        // Dates[0, j) are all <= day, find the first one past it
+        size_t step = 1;
+        size_t hi = j;
+        while (hi < Count && Dates[hi] <= day)
+        {
+            j = hi + 1;
+            hi = j + step;
+            step *= 2;
+        }
+        if (hi > Count)
+            hi = Count;
+        while (j < hi)
+        {
+            size_t mid = j + (hi - j) / 2;
+            if (Dates[mid] <= day)
+                j = mid + 1;
+            else
+                hi = mid;
+        }
+        out[order[k]] = static_cast<long> (j) - 1;
+    }
+}
+
+// the rate for day under a lookup policy, idx being find (day):
+// PreviousClose takes the last rate on or before the day, Exact only a rate
+// for that very day, Interpolate draws a line between the rates around the
+// day (past the last date it keeps the last rate).
+bool RateTable::rateAt (int day, long idx, Lookup policy, double &rate) const
+{
+    if (idx < 0)
+        return false;
+    if (Dates[idx] == day || policy == PreviousClose)
+    {
+        rate = Rates[idx];
+        return true;
+    }
+    if (policy == Exact)
+        return false;
+    if (static_cast<size_t> (idx) + 1 >= Count)
+    {
+        rate = Rates[idx];
+        return true;
+    }
+    double t = static_cast<double> (day - Dates[idx]) / (Dates[idx + 1] - Dates[idx]);
+    rate = Rates[idx] + (Rates[idx + 1] - Rates[idx]) * t;
+    return true;
+}
+
+void RateTable::dropRanges ()
+{
+    delete Ranges;
+    Ranges = NULL;
+}
+
+// the range index costs several times the table itself, so it is only
+// built by the first range query. published tables are shared between
+// threads, hence the lock (the fast path is one acquire load).
+const RangeIndex &RateTable::ranges () const
+{
+    RangeIndex *index = __atomic_load_n (&Ranges, __ATOMIC_ACQUIRE);
+    if (index)
+        return *index;
+    pthread_mutex_lock (&RangesLock);
+    if (!Ranges)
+        __atomic_store_n (&Ranges, new RangeIndex (Dates, Rates, Count), __ATOMIC_RELEASE);
+    index = Ranges;
+    pthread_mutex_unlock (&RangesLock);
+    return *index;
+}
+
+// min, max and mean of the rates dated in [from, to], plus their time
+// weighted average over the days of [from, to] that have a rate at all.
+// false when no rate is dated inside the range.
+bool RateTable::range (int from, int to, Range &out) const
+{
+    if (Count == 0 || from > to)
+        return false;
+    long lo = find (from - 1) + 1;
+    long hi = find (to);
+    if (hi < lo)
+        return false;
+
+    const RangeIndex &index = ranges ();
+    out.count = hi - lo + 1;
+    out.min = index.min (lo, hi);
+    out.max = index.max (lo, hi);
+    out.mean = index.sum (lo, hi) / out.count;
+
+    // held (k) + Rates[k] * (x - Dates[k]) is the rate * days total from the
+    // first date up to day x, k being the last date before x
+    int start = std::max (from, Dates[0]);
+    long first = find (start);
+    double before = index.held (first) + Rates[first] * (start - Dates[first]);
+    double through = index.held (hi) + Rates[hi] * (static_cast<double> (to) + 1 - Dates[hi]);
+    out.twap = (through - before) / (static_cast<double> (to) + 1 - start);
+    return true;
+}
+
+// days in month m (1 to 12) of year y, february 29 in leap years
+int RateTable::daysInMonth (int y, int m)
+{
+    static const int monthDays[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+    bool leap = (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+    return monthDays[m - 1] + (m == 2 && leap);
+}
+
+// days since 1970-01-01 for a proleptic gregorian date. the date scanners
+// reject a day past the end of its month before calling this, the clamp to
+// the last day only keeps any other caller from landing in the next month.
+int RateTable::toDays (int y, int m, int d)
+{
+    int last = daysInMonth (y, m);
+    if (d > last)
+        d = last;
+
+    long long yy = y - (m <= 2);
+    long long era = (yy >= 0 ? yy : yy - 399) / 400;
+    long long yoe = yy - era * 400;
+    long long doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    long long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    long long days = era * 146097 + doe - 719468;
+    if (days > 2147483647LL)
+        return 2147483647;
+    return static_cast<int> (days);
+}
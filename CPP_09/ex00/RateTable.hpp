@@ -0,0 +1,81 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <sys/stat.h>
+#include <pthread.h>
+
+#include "MappedFile.hpp"
+#include "RangeIndex.hpp"
+
+// sorted rate history: date (days since 1970-01-01) i goes with rate i.
+// two flat arrays instead of a node per entry, so lookups stay in cache.
+// the arrays either live in the vectors or inside an mmapped snapshot.
+// a dense per day Calendar over the history answers find () directly.
+class RateTable
+{
+    public:
+        enum Lookup { PreviousClose, Interpolate, Exact };
+
+        // aggregates of the rates dated within a range. twap is the average
+        // over the days of the range of the rate in effect that day (there
+        // are no volumes in data.csv, so time stands in for them).
+        struct Range
+        {
+            size_t  count;
+            double  min;
+            double  max;
+            double  mean;
+            double  twap;
+        };
+    private:
+        static const long MaxCalendar = 1L << 22;
+
+        std::vector<int>    OwnDates;
+        std::vector<double> OwnRates;
+        MappedFile          *Snapshot;
+
+        const int           *Dates;
+        const double        *Rates;
+        size_t              Count;
+        std::vector<int>    Calendar;
+
+        mutable RangeIndex      *Ranges;
+        mutable pthread_mutex_t RangesLock;
+
+        void attachOwn ();
+        void buildCalendar ();
+        void dropRanges ();
+        const RangeIndex &ranges () const;
+
+        struct DayOrder
+        {
+            const int *days;
+            DayOrder (const int *days) : days (days) {}
+            bool operator() (size_t a, size_t b) const { return days[a] < days[b]; }
+        };
+    public:
+        RateTable ();
+        RateTable (const RateTable &other);
+        RateTable &operator= (const RateTable &obj);
+        ~RateTable ();
+
+        void add (int day, double rate);
+        void loadCsv (const char *data, size_t size, bool withHeader);
+        void finalize ();
+
+        bool loadSnapshot (const std::string &fileName, const struct stat &source);
+        bool writeSnapshot (const std::string &fileName, const struct stat &source) const;
+
+        size_t size () const;
+        int date (size_t i) const;
+        double rate (size_t i) const;
+        long find (int day) const;
+        void findBatch (const int *days, size_t n, long *out, std::vector<size_t> &order) const;
+        bool rateAt (int day, long idx, Lookup policy, double &rate) const;
+        bool range (int from, int to, Range &out) const;
+
+        static int daysInMonth (int y, int m);
+        static int toDays (int y, int m, int d);
+};
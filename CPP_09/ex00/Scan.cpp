@@ -0,0 +1,278 @@
+#include "Scan.hpp"
+#include "RateTable.hpp"
+
+#include <string>
+#include <sstream>
+#include <stdexcept>
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
+
+static bool isDigit (char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static bool isSpace (char c)
+{
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+// the old sscanf("%d-%d-%d") parse, kept for everything that isn't a plain
+// YYYY-MM-DD so odd but accepted dates keep working.
+static int scanDateSlow (const char *begin, const char *end)
+{
+    char buf[64];
+    size_t len = end - begin;
+    if (len >= sizeof (buf))
+        len = sizeof (buf) - 1;
+    memcpy (buf, begin, len);
+    buf[len] = '\0';
+
+    int y, m, d;
+    if (sscanf (buf, "%d-%d-%d", &y, &m, &d) != 3)
+        throw std::runtime_error ("invalid date: " + std::string (begin, end));
+    if (y < 1 || d < 1 || m < 1 || m > 12 || d > RateTable::daysInMonth (y, m))
+        throw std::runtime_error ("Error: bad input => " + std::string (begin, end));
+    return RateTable::toDays (y, m, d);
+}
+
+// a plain date is YYYY-MM-DD, maybe followed by blanks, naming a day that
+// exists. those are the only ones the fast paths take.
+static bool blankTail (const char *begin, const char *end)
+{
+    if (end - begin < 10)
+        return false;
+    for (const char *p = begin + 10; p < end; p++)
+        if (*p != ' ' && *p != '\t')
+            return false;
+    return true;
+}
+
+static bool plainDate (const char *p, int &day)
+{
+    if (p[4] != '-' || p[7] != '-'
+        || !isDigit (p[0]) || !isDigit (p[1]) || !isDigit (p[2]) || !isDigit (p[3])
+        || !isDigit (p[5]) || !isDigit (p[6]) || !isDigit (p[8]) || !isDigit (p[9]))
+        return false;
+
+    int y = (p[0] - '0') * 1000 + (p[1] - '0') * 100 + (p[2] - '0') * 10 + (p[3] - '0');
+    int m = (p[5] - '0') * 10 + (p[6] - '0');
+    int d = (p[8] - '0') * 10 + (p[9] - '0');
+    if (y < 1 || d < 1 || m < 1 || m > 12 || d > RateTable::daysInMonth (y, m))
+        return false;
+    day = RateTable::toDays (y, m, d);
+    return true;
+}
+
+// plain dates are read at fixed offsets, anything else goes the slow way,
+// which also throws the messages for bad ones.
+int scanDate (const char *begin, const char *end)
+{
+    int day;
+    if (blankTail (begin, end) && plainDate (begin, day))
+        return day;
+    return scanDateSlow (begin, end);
+}
+
+#ifdef __SSE2__
+
+// sixteen 16 byte rows in, sixteen columns out: four rounds of interleaving
+// row i with row i + 8 move every byte to its transposed place.
+static void transpose (__m128i *rows)
+{
+    __m128i tmp[16];
+    for (int round = 0; round < 4; round++)
+    {
+        for (int i = 0; i < 8; i++)
+        {
+            tmp[2 * i] = _mm_unpacklo_epi8 (rows[i], rows[i + 8]);
+            tmp[2 * i + 1] = _mm_unpackhi_epi8 (rows[i], rows[i + 8]);
+        }
+        for (int i = 0; i < 16; i++)
+            rows[i] = tmp[i];
+    }
+}
+
+static __m128i times10 (__m128i x)
+{
+    __m128i x2 = _mm_add_epi8 (x, x);
+    __m128i x8 = _mm_add_epi8 (_mm_add_epi8 (x2, x2), _mm_add_epi8 (x2, x2));
+    return _mm_add_epi8 (x8, x2);
+}
+
+static __m128i lessEqual (__m128i x, __m128i limit)
+{
+    return _mm_cmpeq_epi8 (_mm_min_epu8 (x, limit), x);
+}
+
+// DateLanes fields laid out as columns, one byte per field in each: every
+// check below runs on all the fields at once. numbers stay bytes, the year
+// as its two halves, which is all the leap year rule needs:
+// 100 * hi + lo is a multiple of 4 when lo is, and of 400 when lo is 0
+// and hi is a multiple of 4. returns one bit per plain date.
+static unsigned checkLanes (const char *const *begins, int *keys)
+{
+    __m128i rows[16];
+    for (size_t i = 0; i < DateLanes; i++)
+    {
+        char row[16] = {0};
+        if (begins[i])
+            memcpy (row, begins[i], 10);
+        rows[i] = _mm_loadu_si128 (reinterpret_cast<const __m128i *> (row));
+    }
+    transpose (rows);
+
+    const __m128i nine = _mm_set1_epi8 (9);
+    const __m128i zero = _mm_setzero_si128 ();
+    const __m128i three = _mm_set1_epi8 (3);
+    __m128i ok = _mm_and_si128 (_mm_cmpeq_epi8 (rows[4], _mm_set1_epi8 ('-')),
+        _mm_cmpeq_epi8 (rows[7], _mm_set1_epi8 ('-')));
+    __m128i digit[10];
+    for (int c = 0; c < 10; c++)
+    {
+        if (c == 4 || c == 7)
+            continue;
+        digit[c] = _mm_sub_epi8 (rows[c], _mm_set1_epi8 ('0'));
+        ok = _mm_and_si128 (ok, lessEqual (digit[c], nine));
+    }
+
+    __m128i hi = _mm_add_epi8 (times10 (digit[0]), digit[1]);
+    __m128i lo = _mm_add_epi8 (times10 (digit[2]), digit[3]);
+    __m128i month = _mm_add_epi8 (times10 (digit[5]), digit[6]);
+    __m128i day = _mm_add_epi8 (times10 (digit[8]), digit[9]);
+
+    // year >= 1, 1 <= month <= 12, day >= 1
+    ok = _mm_andnot_si128 (_mm_cmpeq_epi8 (_mm_or_si128 (hi, lo), zero), ok);
+    ok = _mm_andnot_si128 (_mm_cmpeq_epi8 (month, zero), ok);
+    ok = _mm_and_si128 (ok, lessEqual (month, _mm_set1_epi8 (12)));
+    ok = _mm_andnot_si128 (_mm_cmpeq_epi8 (day, zero), ok);
+
+    // a two digit number ab is a multiple of 4 when 2a + b is
+    __m128i loBy4 = _mm_cmpeq_epi8 (_mm_and_si128 (_mm_add_epi8 (_mm_add_epi8 (digit[2], digit[2]),
+        digit[3]), three), zero);
+    __m128i hiBy4 = _mm_cmpeq_epi8 (_mm_and_si128 (_mm_add_epi8 (_mm_add_epi8 (digit[0], digit[0]),
+        digit[1]), three), zero);
+    __m128i loZero = _mm_cmpeq_epi8 (lo, zero);
+    __m128i leap = _mm_or_si128 (_mm_andnot_si128 (loZero, loBy4), _mm_and_si128 (loZero, hiBy4));
+
+    // 31, less one for the 30 day months, less 3 or 2 for february
+    __m128i thirty = _mm_or_si128 (_mm_or_si128 (_mm_cmpeq_epi8 (month, _mm_set1_epi8 (4)),
+        _mm_cmpeq_epi8 (month, _mm_set1_epi8 (6))), _mm_or_si128 (_mm_cmpeq_epi8 (month,
+        _mm_set1_epi8 (9)), _mm_cmpeq_epi8 (month, _mm_set1_epi8 (11))));
+    __m128i february = _mm_and_si128 (_mm_cmpeq_epi8 (month, _mm_set1_epi8 (2)),
+        _mm_add_epi8 (three, leap));
+    __m128i last = _mm_sub_epi8 (_mm_set1_epi8 (31), _mm_and_si128 (thirty, _mm_set1_epi8 (1)));
+    last = _mm_sub_epi8 (last, february);
+    ok = _mm_and_si128 (ok, lessEqual (day, last));
+
+    unsigned mask = _mm_movemask_epi8 (ok);
+    if (mask)
+    {
+        unsigned char his[16], los[16], months[16], days[16];
+        _mm_storeu_si128 (reinterpret_cast<__m128i *> (his), hi);
+        _mm_storeu_si128 (reinterpret_cast<__m128i *> (los), lo);
+        _mm_storeu_si128 (reinterpret_cast<__m128i *> (months), month);
+        _mm_storeu_si128 (reinterpret_cast<__m128i *> (days), day);
+        for (size_t i = 0; i < DateLanes; i++)
+            if (mask & (1u << i))
+                keys[i] = RateTable::toDays (his[i] * 100 + los[i], months[i], days[i]);
+    }
+    return mask;
+}
+
+#else
+
+static unsigned checkLanes (const char *const *begins, int *keys)
+{
+    unsigned mask = 0;
+    for (size_t i = 0; i < DateLanes; i++)
+        if (begins[i] && plainDate (begins[i], keys[i]))
+            mask |= 1u << i;
+    return mask;
+}
+
+#endif
+
+void scanDates (const char *const *begins, const char *const *ends, size_t n, int *keys, unsigned char *ok)
+{
+    for (size_t base = 0; base < n; base += DateLanes)
+    {
+        size_t lanes = n - base < DateLanes ? n - base : DateLanes;
+        const char *fields[DateLanes];
+        for (size_t i = 0; i < DateLanes; i++)
+            fields[i] = i < lanes && blankTail (begins[base + i], ends[base + i]) ? begins[base + i] : NULL;
+        unsigned mask = checkLanes (fields, keys + base);
+        for (size_t i = 0; i < lanes; i++)
+            ok[base + i] = (mask >> i) & 1;
+    }
+}
+
+// what `ss >> value && (ss >> std::ws).eof ()` accepted, through a stream.
+static bool scanNumberSlow (const char *begin, const char *end, double &value)
+{
+    std::stringstream ss (std::string (begin, end));
+    return (ss >> value) && (ss >> std::ws).eof ();
+}
+
+// [spaces] [sign] digits [. digits] [spaces], with at most 19 significant
+// digits. the mantissa and the power of ten are both exact doubles there,
+// so the one division rounds the same way strtod does. exponents, long
+// mantissas and anything odd fall back to the stream.
+bool scanNumber (const char *begin, const char *end, double &value)
+{
+    static const double pow10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    const char *p = begin;
+    while (p < end && isSpace (*p))
+        p++;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int scale = 0;
+    bool any = false;
+    while (p < end && isDigit (*p))
+    {
+        if (mantissa || *p != '0')
+        {
+            mantissa = mantissa * 10 + (*p - '0');
+            digits++;
+        }
+        any = true;
+        p++;
+    }
+    if (!any)
+        return scanNumberSlow (begin, end, value);
+    if (p < end && *p == '.')
+    {
+        p++;
+        while (p < end && isDigit (*p))
+        {
+            if (mantissa || *p != '0')
+            {
+                mantissa = mantissa * 10 + (*p - '0');
+                digits++;
+            }
+            scale++;
+            p++;
+        }
+    }
+    while (p < end && isSpace (*p))
+        p++;
+    if (p != end || digits > 19 || mantissa > (1ULL << 53) || scale > 22)
+        return scanNumberSlow (begin, end, value);
+
+    value = static_cast<double> (mantissa) / pow10[scale];
+    if (negative)
+        value = -value;
+    return true;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+
+// allocation free field scanners shared by the csv loader and the queries.
+// they only look at [begin, end), the text doesn't need to be terminated.
+
+// how many date fields scanDates checks in one vector pass.
+static const size_t DateLanes = 16;
+
+int scanDate (const char *begin, const char *end);
+bool scanNumber (const char *begin, const char *end, double &value);
+
+// scanDate's fast path for a column of fields at once. ok[i] says field i
+// is a plain YYYY-MM-DD of a day that exists, keys[i] is its day number
+// then. the others still go through scanDate, for the verdict and message.
+void scanDates (const char *const *begins, const char *const *ends, size_t n, int *keys, unsigned char *ok);
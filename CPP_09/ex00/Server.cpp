@@ -0,0 +1,261 @@
+#include "Server.hpp"
+#include "BitcoinExchange.hpp"
+
+#include <stdexcept>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void onSignal (int)
+{
+    stopRequested = 1;
+}
+
+static void setNonBlocking (int fd)
+{
+    fcntl (fd, F_SETFL, fcntl (fd, F_GETFL) | O_NONBLOCK);
+}
+
+Server::Server (const BitcoinExchange &exchange, const std::string &path)
+    : Exchange (exchange), Path (path), Socket (0), Listener (-1), Epoll (-1)
+{
+    struct sockaddr_un addr;
+    if (path.size () >= sizeof (addr.sun_path))
+        throw std::runtime_error ("Error: socket path too long");
+    memset (&addr, 0, sizeof (addr));
+    addr.sun_family = AF_UNIX;
+    memcpy (addr.sun_path, path.c_str (), path.size ());
+
+    Listener = socket (AF_UNIX, SOCK_STREAM, 0);
+    if (Listener < 0)
+        throw std::runtime_error ("Error: could not create socket");
+    // a stale socket left by an earlier run is replaced, anything else at
+    // path is left alone
+    struct stat st;
+    bool stale = lstat (path.c_str (), &st) == 0;
+    if ((stale && !S_ISSOCK (st.st_mode)) || (!stale && errno != ENOENT)
+        || (stale && unlink (path.c_str ()) < 0)
+        || bind (Listener, reinterpret_cast<struct sockaddr *> (&addr), sizeof (addr)) < 0)
+    {
+        close (Listener);
+        throw std::runtime_error ("Error: could not listen on " + path);
+    }
+    if (lstat (path.c_str (), &st) == 0)
+        Socket = st.st_ino;
+    if (listen (Listener, 128) < 0)
+    {
+        close (Listener);
+        removeSocket ();
+        throw std::runtime_error ("Error: could not listen on " + path);
+    }
+    setNonBlocking (Listener);
+
+    Epoll = epoll_create (64);
+    struct epoll_event ev;
+    memset (&ev, 0, sizeof (ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = Listener;
+    if (Epoll < 0 || epoll_ctl (Epoll, EPOLL_CTL_ADD, Listener, &ev) < 0)
+    {
+        if (Epoll >= 0)
+            close (Epoll);
+        close (Listener);
+        removeSocket ();
+        throw std::runtime_error ("Error: could not start event loop");
+    }
+}
+
+Server::~Server ()
+{
+    for (std::map<int, Client>::iterator it = Clients.begin (); it != Clients.end (); ++it)
+        close (it->first);
+    close (Epoll);
+    close (Listener);
+    removeSocket ();
+}
+
+// unlinks path only while it is still the socket bind () made
+void Server::removeSocket ()
+{
+    struct stat st;
+    if (Socket && lstat (Path.c_str (), &st) == 0 && S_ISSOCK (st.st_mode) && st.st_ino == Socket)
+        unlink (Path.c_str ());
+    Socket = 0;
+}
+
+// makes run () return, safe to call from a signal handler.
+void Server::stop ()
+{
+    stopRequested = 1;
+}
+
+void Server::run ()
+{
+    struct sigaction sa;
+    memset (&sa, 0, sizeof (sa));
+    sa.sa_handler = onSignal;
+    sigaction (SIGINT, &sa, NULL);
+    sigaction (SIGTERM, &sa, NULL);
+    signal (SIGPIPE, SIG_IGN);
+
+    struct epoll_event events[64];
+    stopRequested = 0;
+    while (!stopRequested)
+    {
+        int n = epoll_wait (Epoll, events, 64, -1);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error ("Error: epoll_wait failed");
+        }
+        for (int i = 0; i < n; i++)
+        {
+            int fd = events[i].data.fd;
+            if (fd == Listener)
+            {
+                accept ();
+                continue;
+            }
+            std::map<int, Client>::iterator it = Clients.find (fd);
+            if (it == Clients.end ())
+                continue;
+            if (events[i].events & (EPOLLERR | EPOLLHUP) && !(events[i].events & EPOLLIN))
+            {
+                drop (fd);
+                continue;
+            }
+            if (events[i].events & EPOLLOUT)
+                send (fd, it->second);
+            it = Clients.find (fd);
+            if ((events[i].events & EPOLLIN) && it != Clients.end ())
+                receive (fd, it->second);
+        }
+    }
+}
+
+void Server::accept ()
+{
+    while (true)
+    {
+        int fd = ::accept (Listener, NULL, NULL);
+        if (fd < 0)
+            return;
+        setNonBlocking (fd);
+        struct epoll_event ev;
+        memset (&ev, 0, sizeof (ev));
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        if (epoll_ctl (Epoll, EPOLL_CTL_ADD, fd, &ev) < 0)
+        {
+            close (fd);
+            continue;
+        }
+        Client &client = Clients[fd];
+        client.reading = true;
+    }
+}
+
+void Server::drop (int fd)
+{
+    epoll_ctl (Epoll, EPOLL_CTL_DEL, fd, NULL);
+    close (fd);
+    Clients.erase (fd);
+}
+
+// reads what is there, answers every complete line in one go and keeps a
+// trailing partial line for the next read. a client that doesn't read its
+// answers stops being read once MaxPending bytes wait for it. one that
+// sends a line longer than MaxLine is sent an error and hung up on.
+void Server::receive (int fd, Client &client)
+{
+    char buf[ReadSize];
+    bool closed = false;
+    while (client.out.size () < MaxPending)
+    {
+        ssize_t n = read (fd, buf, sizeof (buf));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+        {
+            closed = n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK);
+            break;
+        }
+        client.in.append (buf, n);
+
+        size_t last = client.in.rfind ('\n');
+        if (last != std::string::npos)
+        {
+            OutputSink answers (client.out);
+            Exchange.answerLines (client.in.data (), client.in.data () + last + 1, answers, Scratch);
+            client.in.erase (0, last + 1);
+        }
+        if (client.in.size () > MaxLine)
+        {
+            client.out.append ("Error: line too long\n");
+            client.in.clear ();
+            client.reading = false;
+            break;
+        }
+    }
+    if (closed)
+    {
+        // answer a last line sent without its newline, then hang up
+        if (!client.in.empty ())
+        {
+            OutputSink answers (client.out);
+            Exchange.answerLines (client.in.data (), client.in.data () + client.in.size (), answers, Scratch);
+            client.in.clear ();
+        }
+        client.reading = false;
+    }
+    send (fd, client);
+}
+
+void Server::send (int fd, Client &client)
+{
+    size_t done = 0;
+    while (done < client.out.size ())
+    {
+        ssize_t n = write (fd, client.out.data () + done, client.out.size () - done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        if (n <= 0)
+        {
+            drop (fd);
+            return;
+        }
+        done += n;
+    }
+    client.out.erase (0, done);
+    if (!client.reading && client.out.empty ())
+    {
+        drop (fd);
+        return;
+    }
+    watch (fd, client);
+}
+
+// EPOLLOUT only while answers are waiting, EPOLLIN only while the client is
+// open and not too far behind.
+void Server::watch (int fd, const Client &client)
+{
+    struct epoll_event ev;
+    memset (&ev, 0, sizeof (ev));
+    ev.data.fd = fd;
+    if (client.reading && client.out.size () < MaxPending)
+        ev.events |= EPOLLIN;
+    if (!client.out.empty ())
+        ev.events |= EPOLLOUT;
+    epoll_ctl (Epoll, EPOLL_CTL_MOD, fd, &ev);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+#include <map>
+#include <cstddef>
+#include <sys/types.h>
+
+#include "BitcoinExchange.hpp"
+
+// answers `date | value` lines sent over a unix stream socket, one answer
+// line per request line, in order. one epoll loop serves every client:
+// whatever complete lines a read brings in are answered as one batch and
+// the answers go back in one write, so pipelined clients are cheap.
+class Server
+{
+    private:
+        struct Client
+        {
+            std::string in;
+            std::string out;
+            bool        reading;
+        };
+
+        static const size_t ReadSize = 1 << 16;
+        static const size_t MaxPending = 1 << 22;
+        static const size_t MaxLine = 1 << 12;
+
+        const BitcoinExchange       &Exchange;
+        std::string                 Path;
+        ino_t                       Socket;
+        int                         Listener;
+        int                         Epoll;
+        std::map<int, Client>       Clients;
+        BitcoinExchange::Batch      Scratch;
+
+        Server (const Server &other);
+        Server &operator= (const Server &obj);
+
+        void accept ();
+        void drop (int fd);
+        void removeSocket ();
+        void receive (int fd, Client &client);
+        void send (int fd, Client &client);
+        void watch (int fd, const Client &client);
+    public:
+        Server (const BitcoinExchange &exchange, const std::string &path);
+        ~Server ();
+
+        void run ();
+        static void stop ();
+};
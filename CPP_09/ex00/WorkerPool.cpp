@@ -0,0 +1,122 @@
+#include "WorkerPool.hpp"
+
+#include <stdexcept>
+#include <unistd.h>
+
+WorkerPool::WorkerPool (size_t threads, size_t window)
+    : Threads (threads ? threads : 1), Window (window > Threads ? window : Threads),
+      Slots (Window), Current (NULL), Count (0), Next (0), Written (0), Stop (false)
+{
+    pthread_mutex_init (&Lock, NULL);
+    pthread_cond_init (&JobReady, NULL);
+    pthread_cond_init (&SlotFree, NULL);
+}
+
+WorkerPool::~WorkerPool ()
+{
+    pthread_cond_destroy (&SlotFree);
+    pthread_cond_destroy (&JobReady);
+    pthread_mutex_destroy (&Lock);
+}
+
+size_t WorkerPool::defaultThreads ()
+{
+    long n = sysconf (_SC_NPROCESSORS_ONLN);
+    return n > 0 ? n : 1;
+}
+
+void *WorkerPool::start (void *self)
+{
+    static_cast<WorkerPool *> (self)->work ();
+    return NULL;
+}
+
+void WorkerPool::work ()
+{
+    std::string out;
+    std::string error;
+    while (true)
+    {
+        pthread_mutex_lock (&Lock);
+        while (!Stop && Next < Count && Next >= Written + Window)
+            pthread_cond_wait (&SlotFree, &Lock);
+        if (Stop || Next >= Count)
+        {
+            pthread_mutex_unlock (&Lock);
+            return;
+        }
+        size_t index = Next++;
+        pthread_mutex_unlock (&Lock);
+
+        bool failed = false;
+        out.clear ();
+        try
+        {
+            Current->run (index, out);
+        }
+        catch (const std::exception &e)
+        {
+            failed = true;
+            error = e.what ();
+        }
+
+        pthread_mutex_lock (&Lock);
+        Slot &slot = Slots[index % Window];
+        slot.out.swap (out);
+        slot.error.swap (error);
+        slot.failed = failed;
+        slot.done = true;
+        pthread_cond_broadcast (&JobReady);
+        pthread_mutex_unlock (&Lock);
+    }
+}
+
+void WorkerPool::run (Job &job, size_t count, OutputSink &out)
+{
+    Current = &job;
+    Count = count;
+    Next = 0;
+    Written = 0;
+    Stop = false;
+    for (size_t i = 0; i < Window; i++)
+        Slots[i].done = false;
+
+    std::vector<pthread_t> threads;
+    for (size_t i = 0; i < Threads && i < count; i++)
+    {
+        pthread_t t;
+        if (pthread_create (&t, NULL, &WorkerPool::start, this) != 0)
+            break;
+        threads.push_back (t);
+    }
+    if (threads.empty () && count > 0)
+        throw std::runtime_error ("Error: could not start worker threads");
+
+    std::string chunk;
+    std::string error;
+    bool failed = false;
+    for (size_t i = 0; i < count && !failed; i++)
+    {
+        pthread_mutex_lock (&Lock);
+        Slot &slot = Slots[i % Window];
+        while (!slot.done)
+            pthread_cond_wait (&JobReady, &Lock);
+        chunk.swap (slot.out);
+        error.swap (slot.error);
+        failed = slot.failed;
+        slot.done = false;
+        Written = i + 1;
+        if (failed)
+            Stop = true;
+        pthread_cond_broadcast (&SlotFree);
+        pthread_mutex_unlock (&Lock);
+
+        out.write (chunk.data (), chunk.size ());
+    }
+
+    for (size_t i = 0; i < threads.size (); i++)
+        pthread_join (threads[i], NULL);
+    Current = NULL;
+    if (failed)
+        throw std::runtime_error (error);
+}
@@ -0,0 +1,158 @@
+#include "../BitcoinExchange.hpp"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/resource.h>
+
+// end to end numbers for btc over files from ./gen: loading the history
+// (parse, with and without its snapshot), answering the queries through
+// printall, the latency of one query at a time, and the peak RSS after
+// each step. answers go to /dev/null.
+// usage: ./btc_bench [data.csv] [queries.txt] [threads]
+
+static double now ()
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// ru_maxrss is in KiB on linux
+static double peakMb ()
+{
+    struct rusage usage;
+    getrusage (RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0;
+}
+
+static double percentile (const std::vector<double> &sorted, double p)
+{
+    if (sorted.empty ())
+        return 0;
+    size_t i = static_cast<size_t> (p * (sorted.size () - 1));
+    return sorted[i];
+}
+
+// a last line without its newline counts too
+static size_t countLines (const MappedFile &file)
+{
+    if (file.size () == 0)
+        return 0;
+    const char *end = file.data () + file.size ();
+    return std::count (file.data (), end, '\n') + (end[-1] != '\n');
+}
+
+// runs printall with stdout on /dev/null, returns the seconds it took
+static double timePrintall (BitcoinExchange &btc, const std::string &queries, size_t threads)
+{
+    std::cout.flush ();
+    int saved = dup (STDOUT_FILENO);
+    int null = open ("/dev/null", O_WRONLY);
+    dup2 (null, STDOUT_FILENO);
+    close (null);
+    double start = now ();
+    try
+    {
+        btc.printall (queries, threads);
+    }
+    catch (...)
+    {
+        dup2 (saved, STDOUT_FILENO);
+        close (saved);
+        throw;
+    }
+    double t = now () - start;
+    dup2 (saved, STDOUT_FILENO);
+    close (saved);
+    return t;
+}
+
+int main (int argc, char **argv)
+{
+    std::string data = argc > 1 ? argv[1] : "bench_gen.csv";
+    std::string queries = argc > 2 ? argv[2] : "bench_gen.txt";
+    size_t threads = argc > 3 ? atol (argv[3]) : WorkerPool::defaultThreads ();
+    if (threads < 1)
+        threads = 1;
+
+    try
+    {
+        MappedFile dataFile;
+        MappedFile queryFile;
+        if (!dataFile.open (data) || !queryFile.open (queries))
+            throw std::runtime_error ("Error: could not open file (run ./gen first)");
+        // both files start with a header line and need something after it
+        size_t rows = countLines (dataFile);
+        size_t lines = countLines (queryFile);
+        if (rows < 2)
+            throw std::runtime_error ("Error: no rates in " + data);
+        if (lines < 2)
+            throw std::runtime_error ("Error: no queries in " + queries);
+        rows--;
+        lines--;
+
+        std::string snapshot = data + ".snap";
+        remove (snapshot.c_str ());
+        double start = now ();
+        BitcoinExchange cold (data);
+        double coldTime = now () - start;
+        start = now ();
+        BitcoinExchange btc (data);
+        double warmTime = now () - start;
+        std::cout << "load csv:      " << rows << " rows in " << coldTime * 1000 << " ms, "
+                  << rows / coldTime << " rows/s" << std::endl;
+        std::cout << "load snapshot: " << rows << " rows in " << warmTime * 1000 << " ms" << std::endl;
+        std::cout << "peak rss:      " << peakMb () << " MB" << std::endl;
+
+        double sequential = timePrintall (btc, queries, 1);
+        std::cout << "printall:      " << lines << " queries in " << sequential * 1000 << " ms, "
+                  << lines / sequential << " queries/s" << std::endl;
+        if (threads > 1)
+        {
+            double parallel = timePrintall (btc, queries, threads);
+            std::cout << "printall -j" << threads << ":  " << lines << " queries in " << parallel * 1000
+                      << " ms, " << lines / parallel << " queries/s" << std::endl;
+        }
+        std::cout << "peak rss:      " << peakMb () << " MB" << std::endl;
+
+        // one line per answerLines call, as a server answers them
+        // the header ends at the first newline, countLines saw at least two
+        const char *cur = static_cast<const char *> (memchr (queryFile.data (), '\n', queryFile.size ())) + 1;
+        const char *end = queryFile.data () + queryFile.size ();
+        std::vector<double> latencies;
+        latencies.reserve (std::min<size_t> (lines, 200000));
+        OutputSink out;
+        BitcoinExchange::Batch batch;
+        std::string answers;
+        while (cur < end && latencies.size () < 200000)
+        {
+            const char *nl = static_cast<const char *> (memchr (cur, '\n', end - cur));
+            if (!nl)
+                nl = end;
+            double t = now ();
+            btc.answerLines (cur, nl, out, batch);
+            latencies.push_back (now () - t);
+            out.take (answers);
+            cur = nl + 1;
+        }
+        std::sort (latencies.begin (), latencies.end ());
+        std::cout << "latency:       p50 " << percentile (latencies, 0.50) * 1e6 << " us, p99 "
+                  << percentile (latencies, 0.99) * 1e6 << " us, p99.9 " << percentile (latencies, 0.999) * 1e6
+                  << " us over " << latencies.size () << " queries" << std::endl;
+        std::cout << "peak rss:      " << peakMb () << " MB" << std::endl;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what () << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,131 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+// synthetic input for btc_bench: <prefix>.csv, a daily rate history, and
+// <prefix>.txt, `date | value` queries over it. -s is the share of rows
+// (and of queries) left in date order, the rest is shuffled in; -e is the
+// share of query lines that get one of the per line errors (none of them
+// aborts the run, so every line is answered).
+// usage: ./gen [-r rows] [-q queries] [-s sorted%] [-e error%] [-o prefix]
+
+// YYYY-MM-DD of a day counted from 1970-01-01
+static void formatDay (char *buf, long days)
+{
+    days += 719468;
+    long era = (days >= 0 ? days : days - 146096) / 146097;
+    long doe = days - era * 146097;
+    long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    long mp = (5 * doy + 2) / 153;
+    long d = doy - (153 * mp + 2) / 5 + 1;
+    long m = mp < 10 ? mp + 3 : mp - 9;
+    long y = yoe + era * 400 + (m <= 2);
+    sprintf (buf, "%04ld-%02ld-%02ld", y, m, d);
+}
+
+// keeps sorted% of the items where they are and shuffles the others
+// among their own positions.
+template <typename T>
+static void disorder (std::vector<T> &items, int sorted)
+{
+    std::vector<size_t> moved;
+    for (size_t i = 0; i < items.size (); i++)
+        if (rand () % 100 >= sorted)
+            moved.push_back (i);
+    for (size_t i = moved.size (); i > 1; i--)
+        std::swap (items[moved[i - 1]], items[moved[rand () % i]]);
+}
+
+int main (int argc, char **argv)
+{
+    long rows = 1000000;
+    long queries = 1000000;
+    int sorted = 100;
+    int errors = 5;
+    std::string prefix = "bench_gen";
+    int opt;
+    while ((opt = getopt (argc, argv, "r:q:s:e:o:")) != -1)
+    {
+        if (opt == 'r')
+            rows = atol (optarg);
+        else if (opt == 'q')
+            queries = atol (optarg);
+        else if (opt == 's')
+            sorted = atoi (optarg);
+        else if (opt == 'e')
+            errors = atoi (optarg);
+        else if (opt == 'o')
+            prefix = optarg;
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [-r rows] [-q queries] [-s sorted%] [-e error%] [-o prefix]" << std::endl;
+            return 1;
+        }
+    }
+    // 3.6 million days fit between the years 1 and 9999
+    if (rows < 1 || rows > 3600000 || queries < 0 || sorted < 0 || sorted > 100 || errors < 0 || errors > 100)
+    {
+        std::cerr << "Error: bad option" << std::endl;
+        return 1;
+    }
+    srand (42);
+
+    // the history ends on 2022-12-31, or starts on 0001-01-01 when it's long
+    long first = std::max (19357 - rows + 1, -719162L);
+    long last = first + rows - 1;
+    std::vector<long> days (rows);
+    for (long i = 0; i < rows; i++)
+        days[i] = first + i;
+    disorder (days, sorted);
+
+    char date[16];
+    std::string csvName = prefix + ".csv";
+    std::ofstream csv (csvName.c_str ());
+    csv << "date,exchange_rate\n";
+    for (long i = 0; i < rows; i++)
+    {
+        formatDay (date, days[i]);
+        csv << date << ',' << rand () % 70000 << '.' << rand () % 100 << '\n';
+    }
+
+    // queries fall a month either side of the history, so a few have no
+    // rate, but never before the year 1
+    long from = std::max (first - 30, -719162L);
+    std::vector<long> asked (queries);
+    for (long i = 0; i < queries; i++)
+        asked[i] = from + rand () % (last + 31 - from);
+    std::sort (asked.begin (), asked.end ());
+    disorder (asked, sorted);
+
+    std::string queryName = prefix + ".txt";
+    std::ofstream txt (queryName.c_str ());
+    txt << "date | value\n";
+    for (long i = 0; i < queries; i++)
+    {
+        formatDay (date, asked[i]);
+        if (rand () % 100 >= errors)
+            txt << date << " | " << rand () % 1000 << '.' << rand () % 100 << '\n';
+        else if (rand () % 4 == 0)
+            txt << date << '\n';
+        else if (rand () % 3 == 0)
+            txt << date << " | -" << rand () % 1000 << '\n';
+        else if (rand () % 2 == 0)
+            txt << date << " | " << 1001 + rand () % 100000 << '\n';
+        else
+            txt << date << " | abc\n";
+    }
+    if (!csv || !txt)
+    {
+        std::cerr << "Error: could not write " << prefix << std::endl;
+        return 1;
+    }
+    std::cout << "wrote " << csvName << " (" << rows << " rows) and " << queryName
+              << " (" << queries << " queries), " << sorted << "% sorted, " << errors << "% errors" << std::endl;
+    return 0;
+}
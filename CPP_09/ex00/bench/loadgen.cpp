@@ -0,0 +1,168 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// load generator for `btc -s socket`: each connection sends its requests in
+// pipelined rounds of depth lines, then reads the depth answers back. the
+// latency of a request is the time from its round being sent to its answer
+// line arriving.
+// usage: ./loadgen [-s socket] [-c connections] [-n requests] [-d depth]
+
+struct Connection
+{
+    std::string         path;
+    long                requests;
+    int                 depth;
+    unsigned            seed;
+    std::vector<double> latencies;
+    bool                failed;
+};
+
+static double now ()
+{
+    struct timeval tv;
+    gettimeofday (&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static bool writeAll (int fd, const char *data, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = write (fd, data, len);
+        if (n <= 0)
+            return false;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+static void *runConnection (void *arg)
+{
+    Connection &c = *static_cast<Connection *> (arg);
+    c.failed = true;
+
+    struct sockaddr_un addr;
+    memset (&addr, 0, sizeof (addr));
+    addr.sun_family = AF_UNIX;
+    strncpy (addr.sun_path, c.path.c_str (), sizeof (addr.sun_path) - 1);
+    int fd = socket (AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect (fd, reinterpret_cast<struct sockaddr *> (&addr), sizeof (addr)) < 0)
+        return NULL;
+
+    std::string round;
+    char buf[1 << 16];
+    char line[64];
+    long sent = 0;
+    while (sent < c.requests)
+    {
+        int depth = std::min<long> (c.depth, c.requests - sent);
+        round.clear ();
+        for (int i = 0; i < depth; i++)
+        {
+            int n = snprintf (line, sizeof (line), "%04d-%02d-%02d | %d\n", 2009 + rand_r (&c.seed) % 14,
+                1 + rand_r (&c.seed) % 12, 1 + rand_r (&c.seed) % 28, rand_r (&c.seed) % 1000);
+            round.append (line, n);
+        }
+        double start = now ();
+        if (!writeAll (fd, round.data (), round.size ()))
+            break;
+        int answered = 0;
+        while (answered < depth)
+        {
+            ssize_t n = read (fd, buf, sizeof (buf));
+            if (n <= 0)
+                break;
+            double t = now ();
+            for (ssize_t i = 0; i < n; i++)
+            {
+                if (buf[i] == '\n')
+                {
+                    c.latencies.push_back (t - start);
+                    answered++;
+                }
+            }
+        }
+        if (answered < depth)
+            break;
+        sent += depth;
+    }
+    close (fd);
+    c.failed = sent < c.requests;
+    return NULL;
+}
+
+static double percentile (const std::vector<double> &sorted, double p)
+{
+    if (sorted.empty ())
+        return 0;
+    size_t i = static_cast<size_t> (p * (sorted.size () - 1));
+    return sorted[i];
+}
+
+int main (int argc, char **argv)
+{
+    std::string path = "btc.sock";
+    int connections = 4;
+    long requests = 200000;
+    int depth = 64;
+    int opt;
+    while ((opt = getopt (argc, argv, "s:c:n:d:")) != -1)
+    {
+        if (opt == 's')
+            path = optarg;
+        else if (opt == 'c')
+            connections = atoi (optarg);
+        else if (opt == 'n')
+            requests = atol (optarg);
+        else if (opt == 'd')
+            depth = atoi (optarg);
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [-s socket] [-c connections] [-n requests] [-d depth]" << std::endl;
+            return 1;
+        }
+    }
+    if (connections < 1 || depth < 1 || requests < 1)
+        return 1;
+
+    std::vector<Connection> conns (connections);
+    std::vector<pthread_t> threads (connections);
+    double start = now ();
+    for (int i = 0; i < connections; i++)
+    {
+        conns[i].path = path;
+        conns[i].requests = requests / connections;
+        conns[i].depth = depth;
+        conns[i].seed = i + 1;
+        pthread_create (&threads[i], NULL, runConnection, &conns[i]);
+    }
+    std::vector<double> all;
+    bool failed = false;
+    for (int i = 0; i < connections; i++)
+    {
+        pthread_join (threads[i], NULL);
+        failed = failed || conns[i].failed;
+        all.insert (all.end (), conns[i].latencies.begin (), conns[i].latencies.end ());
+    }
+    double elapsed = now () - start;
+    if (failed)
+        std::cerr << "warning: some connections failed" << std::endl;
+
+    std::sort (all.begin (), all.end ());
+    std::cout << "requests:   " << all.size () << " over " << connections << " connections, depth " << depth << std::endl;
+    std::cout << "throughput: " << all.size () / elapsed << " req/s" << std::endl;
+    std::cout << "latency:    p50 " << percentile (all, 0.50) * 1e6 << " us, p99 "
+              << percentile (all, 0.99) * 1e6 << " us, p99.9 " << percentile (all, 0.999) * 1e6 << " us" << std::endl;
+    return failed ? 1 : 0;
+}
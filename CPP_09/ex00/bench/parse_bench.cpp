@@ -0,0 +1,103 @@
+#include "../RateTable.hpp"
+#include "../MappedFile.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <map>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/time.h>
+
+// ingest throughput of RateTable::loadCsv against the getline/stringstream
+// parser it replaced, over a generated csv of daily rates.
+// usage: ./parse_bench [rows] [file]
+
+static double now ()
+{
+    struct timeval tv;
+    gettimeofday (&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static void writeCsv (const std::string &fileName, long rows)
+{
+    std::ofstream out (fileName.c_str ());
+    out << "date,exchange_rate\n";
+    int y = 1000, m = 1, d = 1;
+    srand (42);
+    char buf[64];
+    for (long i = 0; i < rows; i++)
+    {
+        snprintf (buf, sizeof (buf), "%04d-%02d-%02d,%d.%02d\n", y, m, d, rand () % 70000, rand () % 100);
+        out << buf;
+        if (++d > 28)
+        {
+            d = 1;
+            if (++m > 12)
+            {
+                m = 1;
+                y++;
+            }
+        }
+    }
+}
+
+static size_t legacyParse (const std::string &fileName)
+{
+    std::map<std::string, double> dateValue;
+    std::fstream file (fileName.c_str ());
+    std::string line;
+    std::getline (file, line);
+    while (std::getline (file, line))
+    {
+        size_t pos = line.find (",");
+        std::string date = line.substr (0, pos);
+        int y, m, d;
+        sscanf (date.c_str (), "%d-%d-%d", &y, &m, &d);
+        std::stringstream ss (line.substr (pos + 1));
+        double value;
+        ss >> value;
+        dateValue[date] = value;
+    }
+    return dateValue.size ();
+}
+
+int main (int argc, char **argv)
+{
+    long rows = argc > 1 ? atol (argv[1]) : 3000000;
+    std::string fileName = argc > 2 ? argv[2] : "bench_data.csv";
+
+    writeCsv (fileName, rows);
+    MappedFile file (fileName);
+    double mb = file.size () / (1024.0 * 1024.0);
+    std::cout << "input: " << rows << " rows, " << mb << " MB" << std::endl;
+
+    // best of a few runs, the first one also pays for page faults
+    double best = 1e30;
+    size_t count = 0;
+    for (int run = 0; run < 5; run++)
+    {
+        RateTable table;
+        double start = now ();
+        table.loadCsv (file.data (), file.size (), true);
+        table.finalize ();
+        double t = now () - start;
+        if (t < best)
+            best = t;
+        count = table.size ();
+    }
+    std::cout << "loadCsv:     " << count << " rows in " << best * 1000 << " ms, "
+              << mb / best << " MB/s" << std::endl;
+
+    double start = now ();
+    count = legacyParse (fileName);
+    double legacy = now () - start;
+    std::cout << "getline/map: " << count << " rows in " << legacy * 1000 << " ms, "
+              << mb / legacy << " MB/s" << std::endl;
+    std::cout << "speedup:     " << legacy / best << "x" << std::endl;
+
+    remove (fileName.c_str ());
+    return 0;
+}
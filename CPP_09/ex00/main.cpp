@@ -1,9 +1,77 @@
 #include "BitcoinExchange.hpp"
+#include "Server.hpp"
 
+#include <cerrno>
+#include <cstdlib>
+#include <unistd.h>
 
+static int usage (const char *name)
+{
+    std::cerr << "Usage: " << name << " [-f] [-a assets.csv] [-j threads] [-p prev|interp|exact] file" << std::endl;
+    std::cerr << "       " << name << " [-f] [-a assets.csv] [-p prev|interp|exact] -s socket" << std::endl;
+    return 1;
+}
+
+// a thread count: the whole argument is a number, 0 and up
+static bool parseThreads (const char *text, size_t &threads)
+{
+    char *end;
+    errno = 0;
+    long n = strtol (text, &end, 10);
+    if (end == text || *end || n < 0 || errno == ERANGE)
+        return false;
+    threads = n;
+    return true;
+}
+
+// usage: btc [-f] [-a assets.csv] [-j threads] [-p prev|interp|exact] file
+//        btc [-f] [-a assets.csv] [-p prev|interp|exact] -s socket
+// a file of - reads stdin, in constant memory, so btc can sit anywhere in
+//    a pipeline. so does any file that isn't a regular one.
+// -a loads the rates of other assets from a date,asset,exchange_rate csv,
+//    then `date | asset | value` lines are priced in that asset.
+// -f keeps following data.csv while answering, rows appended to it are
+//    used as soon as they are seen.
+// -j answers the file on that many threads, 0 means one per cpu. more
+//    than 4 per cpu, or than the 1 MiB chunks of the file, are not used.
+// -p picks the rate for dates missing from data.csv: the previous close
+//    (default), a linear interpolation, or none at all.
+// besides `date | value`, a `YYYY-MM-DD .. YYYY-MM-DD` line is answered
+// with the min, max, mean and time weighted average rate over that range.
+// -s serves `date | value` requests on a unix socket instead, loading
+//    data.csv once for all of them. stops on SIGINT / SIGTERM.
+//    make bench also builds ./loadgen, which drives such a server with
+//    pipelined requests and prints their latencies.
 int main (int argc, char **argv)
 {
-    if (argc != 2)
+    size_t threads = 1;
+    RateTable::Lookup policy = RateTable::PreviousClose;
+    bool follow = false;
+    std::string socketPath;
+    std::string assets;
+    int opt;
+    while ((opt = getopt (argc, argv, "a:fj:p:s:")) != -1)
+    {
+        std::string arg = optarg ? optarg : "";
+        if (opt == 'a')
+            assets = arg;
+        else if (opt == 'f')
+            follow = true;
+        else if (opt == 'j' && parseThreads (optarg, threads))
+            threads = threads ? threads : WorkerPool::defaultThreads ();
+        else if (opt == 'p' && arg == "prev")
+            policy = RateTable::PreviousClose;
+        else if (opt == 'p' && arg == "interp")
+            policy = RateTable::Interpolate;
+        else if (opt == 'p' && arg == "exact")
+            policy = RateTable::Exact;
+        else if (opt == 's')
+            socketPath = arg;
+        else
+            return usage (argv[0]);
+    }
+
+    if (argc - optind != (socketPath.empty () ? 1 : 0))
     {
         std::cerr << "Error: could not open file." << std::endl;
         return 1;
@@ -12,7 +80,20 @@ int main (int argc, char **argv)
     try
     {
         BitcoinExchange btc("data.csv");
-        btc.printall(argv[1]);
+        btc.setLookup (policy);
+        if (!assets.empty ())
+            btc.loadAssets (assets);
+        if (follow)
+            btc.follow (1000);
+        if (!socketPath.empty ())
+        {
+            Server server (btc, socketPath);
+            server.run ();
+        }
+        else if (std::string (argv[optind]) == "-")
+            btc.printall (STDIN_FILENO);
+        else
+            btc.printall(argv[optind], threads);
     }
     catch (const std::exception &e)
     {
@@ -20,4 +101,4 @@ int main (int argc, char **argv)
         return 1;
     }
     return 0;
-}
\ No newline at end of file
+}
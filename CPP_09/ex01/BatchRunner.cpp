@@ -0,0 +1,124 @@
+#include "BatchRunner.hpp"
+#include "RPN.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <unistd.h>
+
+class BatchRunner::ChunkJob : public WorkerPool::Job
+{
+    private:
+        const std::vector<const char *>   &Bounds;
+        bool                                Failed;
+    public:
+        ChunkJob (const std::vector<const char *> &bounds) : Bounds (bounds), Failed (false) {}
+
+        void run (size_t index, std::string &out)
+        {
+            RPN rpn;
+            const char *cur = Bounds[index];
+            const char *end = Bounds[index + 1];
+            char buf[32];
+            while (cur < end)
+            {
+                const char *nl = static_cast<const char *> (memchr (cur, '\n', end - cur));
+                if (!nl)
+                    nl = end;
+                try
+                {
+                    Number value = rpn.evaluate (cur, nl);
+                    if (value.isSmall ())
+                        out.append (buf, snprintf (buf, sizeof (buf), "%lld", value.small ()));
+                    else
+                        out += value.toString ();
+                }
+                catch (const std::exception &e)
+                {
+                    out += e.what ();
+                    __atomic_store_n (&Failed, true, __ATOMIC_RELAXED);
+                }
+                out += '\n';
+                cur = nl + 1;
+            }
+        }
+
+        bool failed () const
+        {
+            return __atomic_load_n (&Failed, __ATOMIC_RELAXED);
+        }
+};
+
+BatchRunner::BatchRunner (size_t threads) : Threads (threads ? threads : 1), Failed (false)
+{
+    size_t most = WorkerPool::defaultThreads () * ThreadsPerCpu;
+    if (Threads > most)
+        Threads = most;
+}
+
+BatchRunner::~BatchRunner ()
+{
+}
+
+void BatchRunner::runBlock (const char *begin, const char *end, OutputSink &out)
+{
+    std::vector<const char *> bounds (1, begin);
+    while (bounds.back () < end)
+    {
+        const char *cut = bounds.back () + ChunkSize;
+        if (cut >= end)
+            cut = end;
+        else
+        {
+            const char *nl = static_cast<const char *> (memchr (cut, '\n', end - cut));
+            cut = nl ? nl + 1 : end;
+        }
+        bounds.push_back (cut);
+    }
+
+    size_t threads = Threads < bounds.size () - 1 ? Threads : bounds.size () - 1;
+    ChunkJob job (bounds);
+    WorkerPool pool (threads, threads * 4);
+    pool.run (job, bounds.size () - 1, out);
+    Failed = Failed || job.failed ();
+}
+
+// reads fd to its end, BlockSize bytes at a time (more if a single line is
+// longer). returns false if any line failed.
+bool BatchRunner::run (int fd, OutputSink &out)
+{
+    std::vector<char> buffer (BlockSize);
+    size_t length = 0;
+    bool eof = false;
+    Failed = false;
+    while (!eof || length > 0)
+    {
+        if (!eof && length == buffer.size ())
+            buffer.resize (buffer.size () * 2);
+        if (!eof)
+        {
+            ssize_t n = read (fd, &buffer[length], buffer.size () - length);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0)
+                throw std::runtime_error ("Error: could not read file");
+            eof = n == 0;
+            length += n;
+            if (!eof && length < buffer.size ())
+                continue;
+        }
+
+        // whole lines only, unless the input is over
+        size_t whole = length;
+        while (!eof && whole > 0 && buffer[whole - 1] != '\n')
+            whole--;
+        if (whole == 0)
+            continue;
+        runBlock (&buffer[0], &buffer[0] + whole, out);
+        memmove (&buffer[0], &buffer[0] + whole, length - whole);
+        length -= whole;
+    }
+    out.flush ();
+    return !Failed;
+}
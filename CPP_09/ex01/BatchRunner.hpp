@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+#include "WorkerPool.hpp"
+#include "OutputSink.hpp"
+
+// evaluates a stream of independent expressions, one per line, on a
+// WorkerPool. the input is read a block of whole lines at a time, each
+// block cut into chunks at line ends; a worker evaluates a chunk with an
+// RPN of its own and the pool writes the chunks back in input order. every
+// line gets one line of output, its value or its error, and a bad line
+// doesn't stop the others. at most ThreadsPerCpu threads per cpu are
+// used, and never more than a block has chunks.
+class BatchRunner
+{
+    private:
+        static const size_t BlockSize = 1 << 22;
+        static const size_t ChunkSize = 1 << 16;
+        static const size_t ThreadsPerCpu = 4;
+
+        class ChunkJob;
+
+        size_t  Threads;
+        bool    Failed;
+
+        BatchRunner (const BatchRunner &other);
+        BatchRunner &operator= (const BatchRunner &obj);
+
+        void runBlock (const char *begin, const char *end, OutputSink &out);
+    public:
+        BatchRunner (size_t threads);
+        ~BatchRunner ();
+
+        bool run (int fd, OutputSink &out);
+};
@@ -0,0 +1,424 @@
+#include "BigInt.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <cstdio>
+
+BigInt::BigInt () : Negative (false)
+{
+}
+
+// the magnitude of LLONG_MIN doesn't fit a long long, so it is taken
+// through unsigned arithmetic.
+BigInt::BigInt (long long value) : Negative (value < 0)
+{
+    unsigned long long mag = Negative ? 0ULL - static_cast<unsigned long long> (value) : value;
+    while (mag)
+    {
+        Limbs.push_back (static_cast<uint32_t> (mag));
+        mag >>= 32;
+    }
+}
+
+BigInt::BigInt (const BigInt &other) : Negative (other.Negative), Limbs (other.Limbs)
+{
+}
+
+BigInt &BigInt::operator= (const BigInt &obj)
+{
+    Negative = obj.Negative;
+    Limbs = obj.Limbs;
+    return *this;
+}
+
+BigInt::~BigInt ()
+{
+}
+
+bool BigInt::isZero () const
+{
+    return Limbs.empty ();
+}
+
+// true, with the value, when it is a long long after all.
+bool BigInt::fits (long long &value) const
+{
+    if (Limbs.size () > 2)
+        return false;
+    unsigned long long mag = 0;
+    for (size_t i = Limbs.size (); i > 0; i--)
+        mag = (mag << 32) | Limbs[i - 1];
+    if (mag > (Negative ? 0x8000000000000000ULL : 0x7fffffffffffffffULL))
+        return false;
+    value = Negative ? static_cast<long long> (0ULL - mag) : static_cast<long long> (mag);
+    return true;
+}
+
+// the position of the highest set bit, plus one; 0 for zero
+size_t BigInt::bits () const
+{
+    if (Limbs.empty ())
+        return 0;
+    uint32_t top = Limbs.back ();
+    size_t n = 32 * (Limbs.size () - 1);
+    while (top)
+    {
+        top >>= 1;
+        n++;
+    }
+    return n;
+}
+
+// rounded, inf past the range of a double
+double BigInt::toDouble () const
+{
+    double value = 0;
+    for (size_t i = Limbs.size (); i > 0; i--)
+        value = value * 4294967296.0 + Limbs[i - 1];
+    return Negative ? -value : value;
+}
+
+// an optional sign and decimal digits, which the caller has checked.
+// nine digits at a time, from the most significant end.
+BigInt BigInt::fromString (const char *begin, const char *end)
+{
+    BigInt value;
+    bool negative = begin < end && *begin == '-';
+    if (begin < end && (*begin == '+' || *begin == '-'))
+        begin++;
+    while (begin < end)
+    {
+        uint32_t chunk = 0;
+        uint32_t scale = 1;
+        for (int i = 0; i < 9 && begin < end; i++, begin++)
+        {
+            chunk = chunk * 10 + (*begin - '0');
+            scale *= 10;
+        }
+        multiplySmall (value.Limbs, scale, chunk);
+    }
+    value.Negative = negative && !value.Limbs.empty ();
+    return value;
+}
+
+// nine decimal digits at a time, from the least significant end.
+std::string BigInt::toString () const
+{
+    if (Limbs.empty ())
+        return "0";
+    Magnitude mag (Limbs);
+    std::vector<uint32_t> chunks;
+    while (!mag.empty ())
+        chunks.push_back (divideSmall (mag, 1000000000));
+
+    std::string out (Negative ? "-" : "");
+    char buf[16];
+    snprintf (buf, sizeof (buf), "%u", chunks.back ());
+    out += buf;
+    for (size_t i = chunks.size () - 1; i > 0; i--)
+    {
+        snprintf (buf, sizeof (buf), "%09u", chunks[i - 1]);
+        out += buf;
+    }
+    return out;
+}
+
+void BigInt::trim (Magnitude &a)
+{
+    while (!a.empty () && a.back () == 0)
+        a.pop_back ();
+}
+
+int BigInt::compare (const Magnitude &a, const Magnitude &b)
+{
+    if (a.size () != b.size ())
+        return a.size () < b.size () ? -1 : 1;
+    for (size_t i = a.size (); i > 0; i--)
+        if (a[i - 1] != b[i - 1])
+            return a[i - 1] < b[i - 1] ? -1 : 1;
+    return 0;
+}
+
+void BigInt::add (const Magnitude &a, const Magnitude &b, Magnitude &out)
+{
+    const Magnitude &longer = a.size () >= b.size () ? a : b;
+    const Magnitude &shorter = a.size () >= b.size () ? b : a;
+    Magnitude sum (longer.size () + 1);
+    uint64_t carry = 0;
+    for (size_t i = 0; i < longer.size (); i++)
+    {
+        carry += static_cast<uint64_t> (longer[i]) + (i < shorter.size () ? shorter[i] : 0);
+        sum[i] = static_cast<uint32_t> (carry);
+        carry >>= 32;
+    }
+    sum[longer.size ()] = static_cast<uint32_t> (carry);
+    trim (sum);
+    out.swap (sum);
+}
+
+// a - b for a >= b
+void BigInt::subtract (const Magnitude &a, const Magnitude &b, Magnitude &out)
+{
+    Magnitude diff (a.size ());
+    int64_t borrow = 0;
+    for (size_t i = 0; i < a.size (); i++)
+    {
+        int64_t d = static_cast<int64_t> (a[i]) - (i < b.size () ? b[i] : 0) - borrow;
+        borrow = d < 0;
+        diff[i] = static_cast<uint32_t> (d + (borrow << 32));
+    }
+    trim (diff);
+    out.swap (diff);
+}
+
+// schoolbook product into out[0, n + m), which must start zeroed.
+void BigInt::multiplyLong (const uint32_t *a, size_t n, const uint32_t *b, size_t m, uint32_t *out)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        uint64_t carry = 0;
+        for (size_t j = 0; j < m; j++)
+        {
+            carry += static_cast<uint64_t> (a[i]) * b[j] + out[i + j];
+            out[i + j] = static_cast<uint32_t> (carry);
+            carry >>= 32;
+        }
+        out[i + m] = static_cast<uint32_t> (carry);
+    }
+}
+
+void BigInt::multiply (const Magnitude &a, const Magnitude &b, Magnitude &out)
+{
+    if (a.empty () || b.empty ())
+    {
+        out.clear ();
+        return;
+    }
+    if (std::min (a.size (), b.size ()) >= KaratsubaLimbs)
+    {
+        karatsuba (a, b, out);
+        return;
+    }
+    Magnitude product (a.size () + b.size ());
+    multiplyLong (&a[0], a.size (), &b[0], b.size (), &product[0]);
+    trim (product);
+    out.swap (product);
+}
+
+// to += a * 2^(32 * limbs)
+void BigInt::shiftAdd (Magnitude &to, const Magnitude &a, size_t limbs)
+{
+    if (to.size () < a.size () + limbs + 1)
+        to.resize (a.size () + limbs + 1, 0);
+    uint64_t carry = 0;
+    size_t i = 0;
+    for (; i < a.size (); i++)
+    {
+        carry += static_cast<uint64_t> (to[i + limbs]) + a[i];
+        to[i + limbs] = static_cast<uint32_t> (carry);
+        carry >>= 32;
+    }
+    for (i += limbs; carry && i < to.size (); i++)
+    {
+        carry += to[i];
+        to[i] = static_cast<uint32_t> (carry);
+        carry >>= 32;
+    }
+    trim (to);
+}
+
+// a = a1 B + a0, b = b1 B + b0 with B = 2^(32 half):
+// a b = a1 b1 B^2 + ((a0 + a1)(b0 + b1) - a1 b1 - a0 b0) B + a0 b0,
+// three half size products instead of four.
+void BigInt::karatsuba (const Magnitude &a, const Magnitude &b, Magnitude &out)
+{
+    size_t half = std::max (a.size (), b.size ()) / 2;
+    Magnitude a0 (a.begin (), a.begin () + std::min (half, a.size ()));
+    Magnitude a1 (a.begin () + std::min (half, a.size ()), a.end ());
+    Magnitude b0 (b.begin (), b.begin () + std::min (half, b.size ()));
+    Magnitude b1 (b.begin () + std::min (half, b.size ()), b.end ());
+    trim (a0);
+    trim (b0);
+
+    Magnitude low, high, mid, sa, sb;
+    multiply (a0, b0, low);
+    multiply (a1, b1, high);
+    add (a0, a1, sa);
+    add (b0, b1, sb);
+    multiply (sa, sb, mid);
+    subtract (mid, low, mid);
+    subtract (mid, high, mid);
+
+    Magnitude product (low);
+    shiftAdd (product, mid, half);
+    shiftAdd (product, high, 2 * half);
+    out.swap (product);
+}
+
+// a /= d, returns the remainder
+uint32_t BigInt::divideSmall (Magnitude &a, uint32_t d)
+{
+    uint64_t rem = 0;
+    for (size_t i = a.size (); i > 0; i--)
+    {
+        uint64_t cur = (rem << 32) | a[i - 1];
+        a[i - 1] = static_cast<uint32_t> (cur / d);
+        rem = cur % d;
+    }
+    trim (a);
+    return static_cast<uint32_t> (rem);
+}
+
+// a = a * m + carry
+void BigInt::multiplySmall (Magnitude &a, uint32_t m, uint32_t carry)
+{
+    uint64_t c = carry;
+    for (size_t i = 0; i < a.size (); i++)
+    {
+        c += static_cast<uint64_t> (a[i]) * m;
+        a[i] = static_cast<uint32_t> (c);
+        c >>= 32;
+    }
+    if (c)
+        a.push_back (static_cast<uint32_t> (c));
+}
+
+// q = a / b for b != 0, Knuth's algorithm D: both are shifted so the top
+// limb of b has its high bit set, then every quotient limb is estimated
+// from the top two limbs and corrected at most twice.
+void BigInt::divide (const Magnitude &a, const Magnitude &b, Magnitude &q)
+{
+    if (compare (a, b) < 0)
+    {
+        q.clear ();
+        return;
+    }
+    if (b.size () == 1)
+    {
+        Magnitude quotient (a);
+        divideSmall (quotient, b[0]);
+        q.swap (quotient);
+        return;
+    }
+
+    size_t n = b.size ();
+    size_t m = a.size () - n;
+    int s = 0;
+    while (!(b[n - 1] << s & 0x80000000u))
+        s++;
+    Magnitude v (n);
+    Magnitude u (a.size () + 1);
+    for (size_t i = n - 1; i > 0; i--)
+        v[i] = (b[i] << s) | (s ? b[i - 1] >> (32 - s) : 0);
+    v[0] = b[0] << s;
+    u[a.size ()] = s ? a[a.size () - 1] >> (32 - s) : 0;
+    for (size_t i = a.size () - 1; i > 0; i--)
+        u[i] = (a[i] << s) | (s ? a[i - 1] >> (32 - s) : 0);
+    u[0] = a[0] << s;
+
+    Magnitude quotient (m + 1);
+    const uint64_t base = 1ULL << 32;
+    for (size_t j = m + 1; j > 0; j--)
+    {
+        size_t k = j - 1;
+        uint64_t top = (static_cast<uint64_t> (u[k + n]) << 32) | u[k + n - 1];
+        uint64_t qhat = top / v[n - 1];
+        uint64_t rhat = top % v[n - 1];
+        while (qhat >= base || qhat * v[n - 2] > ((rhat << 32) | u[k + n - 2]))
+        {
+            qhat--;
+            rhat += v[n - 1];
+            if (rhat >= base)
+                break;
+        }
+
+        int64_t borrow = 0;
+        uint64_t carry = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            carry += qhat * v[i];
+            int64_t t = static_cast<int64_t> (u[i + k]) - borrow - static_cast<int64_t> (carry & 0xffffffffu);
+            u[i + k] = static_cast<uint32_t> (t);
+            carry >>= 32;
+            borrow = t < 0;
+        }
+        int64_t t = static_cast<int64_t> (u[k + n]) - borrow - static_cast<int64_t> (carry);
+        u[k + n] = static_cast<uint32_t> (t);
+
+        // qhat was one too many: add v back
+        if (t < 0)
+        {
+            qhat--;
+            uint64_t c = 0;
+            for (size_t i = 0; i < n; i++)
+            {
+                c += static_cast<uint64_t> (u[i + k]) + v[i];
+                u[i + k] = static_cast<uint32_t> (c);
+                c >>= 32;
+            }
+            u[k + n] += static_cast<uint32_t> (c);
+        }
+        quotient[k] = static_cast<uint32_t> (qhat);
+    }
+    trim (quotient);
+    q.swap (quotient);
+}
+
+// a + b, or a - b with negateB
+BigInt BigInt::signedSum (const BigInt &a, const BigInt &b, bool negateB)
+{
+    bool bNegative = b.Negative != negateB;
+    BigInt sum;
+    if (a.Negative == bNegative)
+    {
+        add (a.Limbs, b.Limbs, sum.Limbs);
+        sum.Negative = a.Negative;
+    }
+    else if (compare (a.Limbs, b.Limbs) >= 0)
+    {
+        subtract (a.Limbs, b.Limbs, sum.Limbs);
+        sum.Negative = a.Negative;
+    }
+    else
+    {
+        subtract (b.Limbs, a.Limbs, sum.Limbs);
+        sum.Negative = bNegative;
+    }
+    if (sum.Limbs.empty ())
+        sum.Negative = false;
+    return sum;
+}
+
+BigInt operator+ (const BigInt &a, const BigInt &b)
+{
+    return BigInt::signedSum (a, b, false);
+}
+
+BigInt operator- (const BigInt &a, const BigInt &b)
+{
+    return BigInt::signedSum (a, b, true);
+}
+
+BigInt operator* (const BigInt &a, const BigInt &b)
+{
+    BigInt product;
+    BigInt::multiply (a.Limbs, b.Limbs, product.Limbs);
+    product.Negative = !product.Limbs.empty () && a.Negative != b.Negative;
+    return product;
+}
+
+BigInt operator/ (const BigInt &a, const BigInt &b)
+{
+    if (b.Limbs.empty ())
+        throw std::runtime_error ("Error: division by zero");
+    BigInt quotient;
+    BigInt::divide (a.Limbs, b.Limbs, quotient.Limbs);
+    quotient.Negative = !quotient.Limbs.empty () && a.Negative != b.Negative;
+    return quotient;
+}
+
+// the sign of a, like % on the built in types: a == (a / b) * b + a % b
+BigInt operator% (const BigInt &a, const BigInt &b)
+{
+    return a - (a / b) * b;
+}
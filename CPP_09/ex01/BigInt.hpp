@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// signed integer of any size: a sign and a magnitude in base 2^32 limbs,
+// least significant first, without leading zero limbs (zero has none).
+// products of long operands use Karatsuba, quotients Knuth's algorithm D,
+// both truncating toward zero like the built in types do.
+class BigInt
+{
+    private:
+        typedef std::vector<uint32_t> Magnitude;
+
+        static const size_t KaratsubaLimbs = 32;
+
+        bool        Negative;
+        Magnitude   Limbs;
+
+        static void trim (Magnitude &a);
+        static int compare (const Magnitude &a, const Magnitude &b);
+        static void add (const Magnitude &a, const Magnitude &b, Magnitude &out);
+        static void subtract (const Magnitude &a, const Magnitude &b, Magnitude &out);
+        static void multiplyLong (const uint32_t *a, size_t n, const uint32_t *b, size_t m, uint32_t *out);
+        static void multiply (const Magnitude &a, const Magnitude &b, Magnitude &out);
+        static void karatsuba (const Magnitude &a, const Magnitude &b, Magnitude &out);
+        static void shiftAdd (Magnitude &to, const Magnitude &a, size_t limbs);
+        static uint32_t divideSmall (Magnitude &a, uint32_t d);
+        static void multiplySmall (Magnitude &a, uint32_t m, uint32_t carry);
+        static void divide (const Magnitude &a, const Magnitude &b, Magnitude &q);
+
+        static BigInt signedSum (const BigInt &a, const BigInt &b, bool negateB);
+    public:
+        BigInt ();
+        BigInt (long long value);
+        BigInt (const BigInt &other);
+        BigInt &operator= (const BigInt &obj);
+        ~BigInt ();
+
+        bool isZero () const;
+        bool fits (long long &value) const;
+        size_t bits () const;
+        double toDouble () const;
+        std::string toString () const;
+        static BigInt fromString (const char *begin, const char *end);
+
+        friend BigInt operator+ (const BigInt &a, const BigInt &b);
+        friend BigInt operator- (const BigInt &a, const BigInt &b);
+        friend BigInt operator* (const BigInt &a, const BigInt &b);
+        friend BigInt operator/ (const BigInt &a, const BigInt &b);
+};
+
+BigInt operator+ (const BigInt &a, const BigInt &b);
+BigInt operator- (const BigInt &a, const BigInt &b);
+BigInt operator* (const BigInt &a, const BigInt &b);
+BigInt operator/ (const BigInt &a, const BigInt &b);
+BigInt operator% (const BigInt &a, const BigInt &b);
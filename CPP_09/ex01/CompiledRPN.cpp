@@ -0,0 +1,342 @@
+#include "CompiledRPN.hpp"
+#include "Scan.hpp"
+
+#include <cctype>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
+
+CompiledRPN::CompiledRPN () : Depth (0), Slots (0)
+{
+}
+
+CompiledRPN::CompiledRPN (const std::string &expression) : Depth (0), Slots (0)
+{
+    compile (expression);
+}
+
+CompiledRPN::CompiledRPN (const CompiledRPN &other)
+    : Code (other.Code), Immediates (other.Immediates), Variables (other.Variables), Depth (other.Depth),
+      Slots (other.Slots)
+{
+}
+
+CompiledRPN &CompiledRPN::operator= (const CompiledRPN &obj)
+{
+    Code = obj.Code;
+    Immediates = obj.Immediates;
+    Variables = obj.Variables;
+    Depth = obj.Depth;
+    Slots = obj.Slots;
+    return *this;
+}
+
+static bool isName (const std::string &token)
+{
+    if (!isalpha (static_cast<unsigned char> (token[0])) && token[0] != '_')
+        return false;
+    for (size_t i = 1; i < token.size (); i++)
+        if (!isalnum (static_cast<unsigned char> (token[i])) && token[i] != '_')
+            return false;
+    return true;
+}
+
+CompiledRPN::~CompiledRPN ()
+{
+}
+
+// same tokens and checks as RPN::calculate, but the stack is only counted:
+// an operator needs two entries and the expression must leave exactly one.
+void CompiledRPN::compile (const std::string &expression)
+{
+    std::vector<unsigned char> code;
+    std::vector<long long> immediates;
+    std::vector<std::string> variables;
+    size_t depth = 0;
+    size_t maxDepth = 0;
+
+    const char *cur = expression.data ();
+    const char *end = cur + expression.size ();
+    const char *begin;
+    while (nextToken (cur, end, begin))
+    {
+        std::string token (begin, cur);
+        if (token == "+" || token == "-" || token == "*" || token == "/")
+        {
+            if (depth < 2)
+                throw std::runtime_error ("Error: invalid expression");
+            depth--;
+            if (token == "+")
+                code.push_back (Add);
+            else if (token == "-")
+                code.push_back (Subtract);
+            else if (token == "*")
+                code.push_back (Multiply);
+            else
+                code.push_back (Divide);
+        }
+        else if (isName (token))
+        {
+            size_t index = 0;
+            while (index < variables.size () && variables[index] != token)
+                index++;
+            if (index == variables.size ())
+                variables.push_back (token);
+            code.push_back (Load);
+            immediates.push_back (index);
+        }
+        else
+        {
+            int num;
+            if (!scanLiteral (begin, cur, num) || num > 9)
+                throw std::runtime_error ("Error: invalid token");
+            code.push_back (Push);
+            immediates.push_back (num);
+        }
+        if ((code.back () == Push || code.back () == Load) && ++depth > maxDepth)
+            maxDepth = depth;
+    }
+    if (depth != 1)
+        throw std::runtime_error ("Error: invalid expression");
+    code.push_back (End);
+
+    Code.swap (code);
+    Immediates.swap (immediates);
+    Variables.swap (variables);
+    Depth = maxDepth;
+    Slots = 0;
+}
+
+Number CompiledRPN::evaluate () const
+{
+    if (!Variables.empty ())
+        throw std::runtime_error ("Error: unbound variable " + Variables[0]);
+    return evaluate (NULL);
+}
+
+// values[i] is the value of variable (i). threaded dispatch: every handler
+// jumps straight to the next one through the label table (a gcc / clang
+// extension), there is no central switch. the stack needs no bounds
+// checks, compile () proved the depths. the slots sit right after the stack.
+Number CompiledRPN::evaluate (const long long *values) const
+{
+    static void *const handlers[] = { &&push, &&load, &&recall, &&store, &&add, &&subtract, &&multiply, &&divide, &&end };
+
+    if (Code.empty ())
+        throw std::runtime_error ("Error: invalid expression");
+    long long local[StackSize];
+    std::vector<long long> heap;
+    long long *sp = local;
+    if (Depth + Slots > StackSize)
+    {
+        heap.resize (Depth + Slots);
+        sp = &heap[0];
+    }
+    long long *slots = sp + Depth;
+    const unsigned char *pc = &Code[0];
+    const long long *imm = Immediates.empty () ? NULL : &Immediates[0];
+
+#define NEXT goto *handlers[*pc++]
+    NEXT;
+push:
+    *sp++ = *imm++;
+    NEXT;
+load:
+    *sp++ = values[*imm++];
+    NEXT;
+recall:
+    *sp++ = slots[*imm++];
+    NEXT;
+store:
+    slots[*imm++] = sp[-1];
+    NEXT;
+add:
+    sp--;
+    if (__builtin_add_overflow (sp[-1], sp[0], &sp[-1]))
+        return evaluateWide (values);
+    NEXT;
+subtract:
+    sp--;
+    if (__builtin_sub_overflow (sp[-1], sp[0], &sp[-1]))
+        return evaluateWide (values);
+    NEXT;
+multiply:
+    sp--;
+    if (__builtin_mul_overflow (sp[-1], sp[0], &sp[-1]))
+        return evaluateWide (values);
+    NEXT;
+divide:
+    sp--;
+    if (sp[0] == 0)
+        throw std::runtime_error ("Error: division by zero");
+    if (sp[-1] == LLONG_MIN && sp[0] == -1)
+        return evaluateWide (values);
+    sp[-1] /= sp[0];
+    NEXT;
+end:
+    return Number (sp[-1]);
+#undef NEXT
+}
+
+// the same program on Numbers, for when a word overflowed.
+Number CompiledRPN::evaluateWide (const long long *values) const
+{
+    std::vector<Number> stack;
+    std::vector<Number> slots (Slots);
+    stack.reserve (Depth);
+    const long long *imm = Immediates.empty () ? NULL : &Immediates[0];
+    for (size_t pc = 0; Code[pc] != End; pc++)
+    {
+        if (Code[pc] == Push)
+        {
+            stack.push_back (Number (*imm++));
+            continue;
+        }
+        if (Code[pc] == Load)
+        {
+            stack.push_back (Number (values[*imm++]));
+            continue;
+        }
+        if (Code[pc] == Recall)
+        {
+            stack.push_back (slots[*imm++]);
+            continue;
+        }
+        if (Code[pc] == Store)
+        {
+            slots[*imm++] = stack.back ();
+            continue;
+        }
+        Number b = stack.back ();
+        stack.pop_back ();
+        Number &a = stack.back ();
+        if (Code[pc] == Add)
+            a = Number::add (a, b);
+        else if (Code[pc] == Subtract)
+            a = Number::subtract (a, b);
+        else if (Code[pc] == Multiply)
+            a = Number::multiply (a, b);
+        else
+            a = Number::divide (a, b);
+    }
+    return stack.back ();
+}
+
+#ifdef __SSE2__
+# define COLUMN_OP(name, vector, scalar) \
+    static void name (double *a, const double *b, size_t n) \
+    { \
+        size_t i = 0; \
+        for (; i + 4 <= n; i += 4) \
+        { \
+            _mm_storeu_pd (a + i, vector (_mm_loadu_pd (a + i), _mm_loadu_pd (b + i))); \
+            _mm_storeu_pd (a + i + 2, vector (_mm_loadu_pd (a + i + 2), _mm_loadu_pd (b + i + 2))); \
+        } \
+        for (; i < n; i++) \
+            a[i] = a[i] scalar b[i]; \
+    }
+#else
+# define COLUMN_OP(name, vector, scalar) \
+    static void name (double *a, const double *b, size_t n) \
+    { \
+        for (size_t i = 0; i < n; i++) \
+            a[i] = a[i] scalar b[i]; \
+    }
+#endif
+
+// a[i] = a[i] op b[i] over a block, two doubles per SSE2 register
+COLUMN_OP (addColumn, _mm_add_pd, +)
+COLUMN_OP (subtractColumn, _mm_sub_pd, -)
+COLUMN_OP (multiplyColumn, _mm_mul_pd, *)
+COLUMN_OP (divideColumn, _mm_div_pd, /)
+#undef COLUMN_OP
+
+// columns[i][row] is the value of variable (i) in that row. the stack is
+// Depth blocks of BlockRows doubles, each instruction consumes and
+// produces whole blocks. the Slots blocks follow the stack.
+void CompiledRPN::evaluate (const double *const *columns, size_t rows, double *out) const
+{
+    if (Code.empty ())
+        throw std::runtime_error ("Error: invalid expression");
+    std::vector<double> stack ((Depth + Slots) * BlockRows);
+    double *slots = &stack[0] + Depth * BlockRows;
+    for (size_t base = 0; base < rows; base += BlockRows)
+    {
+        size_t n = rows - base < BlockRows ? rows - base : BlockRows;
+        double *top = &stack[0];
+        const long long *imm = Immediates.empty () ? NULL : &Immediates[0];
+        for (size_t pc = 0; Code[pc] != End; pc++)
+        {
+            switch (Code[pc])
+            {
+                case Push:
+                    for (size_t i = 0; i < n; i++)
+                        top[i] = static_cast<double> (*imm);
+                    imm++;
+                    top += BlockRows;
+                    break;
+                case Load:
+                    memcpy (top, columns[*imm++] + base, n * sizeof (double));
+                    top += BlockRows;
+                    break;
+                case Recall:
+                    memcpy (top, slots + *imm++ * BlockRows, n * sizeof (double));
+                    top += BlockRows;
+                    break;
+                case Store:
+                    memcpy (slots + *imm++ * BlockRows, top - BlockRows, n * sizeof (double));
+                    break;
+                case Add:
+                    top -= BlockRows;
+                    addColumn (top - BlockRows, top, n);
+                    break;
+                case Subtract:
+                    top -= BlockRows;
+                    subtractColumn (top - BlockRows, top, n);
+                    break;
+                case Multiply:
+                    top -= BlockRows;
+                    multiplyColumn (top - BlockRows, top, n);
+                    break;
+                case Divide:
+                    top -= BlockRows;
+                    divideColumn (top - BlockRows, top, n);
+                    break;
+            }
+        }
+        memcpy (out + base, top - BlockRows, n * sizeof (double));
+    }
+}
+
+// instructions, End included
+size_t CompiledRPN::size () const
+{
+    return Code.size ();
+}
+
+size_t CompiledRPN::depth () const
+{
+    return Depth;
+}
+
+size_t CompiledRPN::variables () const
+{
+    return Variables.size ();
+}
+
+const std::string &CompiledRPN::variable (size_t index) const
+{
+    return Variables[index];
+}
+
+// the index of a variable, -1 if the expression doesn't use it
+long CompiledRPN::find (const std::string &name) const
+{
+    for (size_t i = 0; i < Variables.size (); i++)
+        if (Variables[i] == name)
+            return i;
+    return -1;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Number.hpp"
+
+// an RPN expression parsed and checked once, then evaluated any number of
+// times. the program is a byte per instruction plus a separate column of
+// immediates, in order: the value of a push, the variable index of a load.
+// compile () rejects the expression with the messages RPN::calculate uses,
+// so evaluate () only fails on a division by zero. it runs on long long
+// words with a fixed size stack, and only restarts on Numbers if something
+// overflows. besides literals, names like x or rate_2 are variables, bound
+// by index at every evaluation. Store and Recall copy the top of the stack
+// to a slot and back; compile () never emits them, the Optimizer does for
+// the sub-expressions it shares.
+//
+// the column form evaluates the program for many bindings at once, in
+// doubles: each instruction runs over a block of BlockRows rows before the
+// next one, as a SIMD loop, so dispatch is paid per block, not per row.
+// division is the floating one there, x / 0 gives inf or nan.
+class CompiledRPN
+{
+    public:
+        enum Opcode { Push, Load, Recall, Store, Add, Subtract, Multiply, Divide, End };
+    private:
+        static const size_t StackSize = 64;
+        static const size_t BlockRows = 256;
+
+        std::vector<unsigned char>  Code;
+        std::vector<long long>      Immediates;
+        std::vector<std::string>    Variables;
+        size_t                      Depth;
+        size_t                      Slots;
+
+        Number evaluateWide (const long long *values) const;
+    public:
+        CompiledRPN ();
+        CompiledRPN (const std::string &expression);
+        CompiledRPN (const CompiledRPN &other);
+        CompiledRPN &operator= (const CompiledRPN &obj);
+        ~CompiledRPN ();
+
+        void compile (const std::string &expression);
+        Number evaluate () const;
+        Number evaluate (const long long *values) const;
+        void evaluate (const double *const *columns, size_t rows, double *out) const;
+
+        size_t size () const;
+        size_t depth () const;
+        size_t variables () const;
+        const std::string &variable (size_t index) const;
+        long find (const std::string &name) const;
+
+        friend class Optimizer;
+};
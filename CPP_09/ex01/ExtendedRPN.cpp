@@ -0,0 +1,147 @@
+#include "ExtendedRPN.hpp"
+#include "Scan.hpp"
+
+#include <cerrno>
+#include <stdexcept>
+#include <unistd.h>
+
+ExtendedRPN::ExtendedRPN ()
+{
+}
+
+ExtendedRPN::ExtendedRPN (const ExtendedRPN &other) : Stack (other.Stack), Pending (other.Pending)
+{
+}
+
+ExtendedRPN &ExtendedRPN::operator= (const ExtendedRPN &obj)
+{
+    Stack = obj.Stack;
+    Pending = obj.Pending;
+    return *this;
+}
+
+ExtendedRPN::~ExtendedRPN ()
+{
+}
+
+// one complete token
+void ExtendedRPN::apply (const char *begin, const char *end)
+{
+    if (end - begin == 1 && *begin == '~')
+    {
+        if (Stack.empty ())
+            throw std::runtime_error ("Error: invalid expression");
+        Stack.back () = Value::negate (Stack.back ());
+        return;
+    }
+    if (end - begin == 1 && (*begin == '+' || *begin == '-' || *begin == '*' || *begin == '/'
+        || *begin == '%' || *begin == '^'))
+    {
+        if (Stack.size () < 2)
+            throw std::runtime_error ("Error: invalid expression");
+        const Value &b = Stack.back ();
+        Value &a = Stack[Stack.size () - 2];
+        switch (*begin)
+        {
+            case '+':
+                a = Value::add (a, b);
+                break;
+            case '-':
+                a = Value::subtract (a, b);
+                break;
+            case '*':
+                a = Value::multiply (a, b);
+                break;
+            case '/':
+                a = Value::divide (a, b);
+                break;
+            case '%':
+                a = Value::remainder (a, b);
+                break;
+            case '^':
+                a = Value::power (a, b);
+                break;
+        }
+        Stack.pop_back ();
+        return;
+    }
+    Value value;
+    if (!Value::parse (begin, end, value))
+        throw std::runtime_error ("Error: invalid token");
+    Stack.push_back (value);
+}
+
+// the next piece of the text. a token reaching the end of the piece may go
+// on in the next one, so it is kept instead of applied.
+void ExtendedRPN::feed (const char *begin, const char *end)
+{
+    const char *cur = begin;
+    if (!Pending.empty ())
+    {
+        while (cur < end && !isSpace (*cur))
+            cur++;
+        Pending.append (begin, cur);
+        if (cur == end)
+            return;
+        apply (Pending.data (), Pending.data () + Pending.size ());
+        Pending.clear ();
+    }
+    const char *token;
+    while (nextToken (cur, end, token))
+    {
+        if (cur == end)
+        {
+            Pending.assign (token, cur);
+            return;
+        }
+        apply (token, cur);
+    }
+}
+
+// the end of the text: the last token is complete, and the expression must
+// have left exactly one value
+Value ExtendedRPN::finish ()
+{
+    if (!Pending.empty ())
+    {
+        apply (Pending.data (), Pending.data () + Pending.size ());
+        Pending.clear ();
+    }
+    if (Stack.size () != 1)
+        throw std::runtime_error ("Error: invalid expression");
+    return Stack.back ();
+}
+
+// every evaluation starts on an empty stack
+Value ExtendedRPN::evaluate (const std::string &expression)
+{
+    Stack.clear ();
+    Pending.clear ();
+    feed (expression.data (), expression.data () + expression.size ());
+    return finish ();
+}
+
+// reads fd to its end, ReadSize bytes at a time
+Value ExtendedRPN::evaluate (int fd)
+{
+    Stack.clear ();
+    Pending.clear ();
+    std::vector<char> buffer (ReadSize);
+    for (;;)
+    {
+        ssize_t n = read (fd, &buffer[0], buffer.size ());
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            throw std::runtime_error ("Error: could not read file");
+        if (n == 0)
+            break;
+        feed (&buffer[0], &buffer[0] + n);
+    }
+    return finish ();
+}
+
+void ExtendedRPN::calculate (const std::string &expression)
+{
+    std::cout << evaluate (expression) << std::endl;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Value.hpp"
+
+// the extended syntax: literals of any length, integer or floating (12,
+// -340282366920938463463374607431768211456, 2.5, 1e-3), the binary
+// operators + - * / % ^ and the unary ~, which negates. see Value for the
+// arithmetic.
+//
+// the text is fed to it in pieces, each token is applied as soon as it is
+// complete, so an expression read from a file descriptor is evaluated in
+// ReadSize bytes of buffer plus the stack, however long the file is. a
+// token cut by the end of a piece waits in Pending for the rest of it.
+class ExtendedRPN
+{
+    private:
+        static const size_t ReadSize = 1 << 16;
+
+        std::vector<Value>  Stack;
+        std::string         Pending;
+
+        void apply (const char *begin, const char *end);
+        void feed (const char *begin, const char *end);
+        Value finish ();
+    public:
+        ExtendedRPN ();
+        ExtendedRPN (const ExtendedRPN &other);
+        ExtendedRPN &operator= (const ExtendedRPN &obj);
+        ~ExtendedRPN ();
+
+        Value evaluate (const std::string &expression);
+        Value evaluate (int fd);
+        void calculate (const std::string &expression);
+};
@@ -0,0 +1,173 @@
+#include "Number.hpp"
+
+#include <climits>
+#include <stdexcept>
+
+Number::Number () : Small (0), Big (NULL)
+{
+}
+
+Number::Number (long long value) : Small (value), Big (NULL)
+{
+}
+
+Number::Number (const Number &other) : Small (other.Small), Big (NULL)
+{
+    if (other.Big)
+        Big = new BigInt (*other.Big);
+}
+
+Number &Number::operator= (const Number &obj)
+{
+    if (this != &obj)
+    {
+        BigInt *copy = obj.Big ? new BigInt (*obj.Big) : NULL;
+        delete Big;
+        Big = copy;
+        Small = obj.Small;
+    }
+    return *this;
+}
+
+Number::~Number ()
+{
+    delete Big;
+}
+
+Number Number::fromBig (const BigInt &value)
+{
+    Number n;
+    if (!value.fits (n.Small))
+        n.Big = new BigInt (value);
+    return n;
+}
+
+BigInt Number::big () const
+{
+    return Big ? *Big : BigInt (Small);
+}
+
+bool Number::isZero () const
+{
+    return !Big && Small == 0;
+}
+
+bool Number::isSmall () const
+{
+    return !Big;
+}
+
+long long Number::small () const
+{
+    return Small;
+}
+
+double Number::toDouble () const
+{
+    return Big ? Big->toDouble () : static_cast<double> (Small);
+}
+
+std::string Number::toString () const
+{
+    return big ().toString ();
+}
+
+// an optional sign and decimal digits, checked by the caller. up to 18
+// digits always fit a word.
+Number Number::fromString (const char *begin, const char *end)
+{
+    const char *digits = begin < end && (*begin == '+' || *begin == '-') ? begin + 1 : begin;
+    if (end - digits > 18)
+        return fromBig (BigInt::fromString (begin, end));
+    long long value = 0;
+    for (const char *p = digits; p < end; p++)
+        value = value * 10 + (*p - '0');
+    return Number (digits != begin && *begin == '-' ? -value : value);
+}
+
+Number Number::add (const Number &a, const Number &b)
+{
+    long long r;
+    if (!a.Big && !b.Big && !__builtin_add_overflow (a.Small, b.Small, &r))
+        return Number (r);
+    return fromBig (a.big () + b.big ());
+}
+
+Number Number::subtract (const Number &a, const Number &b)
+{
+    long long r;
+    if (!a.Big && !b.Big && !__builtin_sub_overflow (a.Small, b.Small, &r))
+        return Number (r);
+    return fromBig (a.big () - b.big ());
+}
+
+Number Number::multiply (const Number &a, const Number &b)
+{
+    long long r;
+    if (!a.Big && !b.Big && !__builtin_mul_overflow (a.Small, b.Small, &r))
+        return Number (r);
+    return fromBig (a.big () * b.big ());
+}
+
+// truncates toward zero. LLONG_MIN / -1 is the one quotient of two words
+// that doesn't fit a word.
+Number Number::divide (const Number &a, const Number &b)
+{
+    if (b.isZero ())
+        throw std::runtime_error ("Error: division by zero");
+    if (!a.Big && !b.Big && !(a.Small == LLONG_MIN && b.Small == -1))
+        return Number (a.Small / b.Small);
+    return fromBig (a.big () / b.big ());
+}
+
+// the sign of a, a == (a / b) * b + a % b. LLONG_MIN % -1 is 0, but traps
+// as a machine instruction.
+Number Number::remainder (const Number &a, const Number &b)
+{
+    if (b.isZero ())
+        throw std::runtime_error ("Error: division by zero");
+    if (!a.Big && !b.Big)
+        return Number (b.Small == -1 ? 0 : a.Small % b.Small);
+    return fromBig (a.big () % b.big ());
+}
+
+// a to the b by squaring. a negative b is 1 / a^-b truncated like divide,
+// so 0 for every a but 0, 1 and -1. a result of more than MaxPowerBits bits
+// is refused before any of it is computed.
+Number Number::power (const Number &a, const Number &b)
+{
+    bool negative = b.toDouble () < 0;
+    if (a.isZero () && negative)
+        throw std::runtime_error ("Error: division by zero");
+    if (b.isZero ())
+        return Number (1);
+    if (!a.Big && (a.Small == 0 || a.Small == 1))
+        return a;
+    if (!a.Big && a.Small == -1)
+        return Number (remainder (b, 2).isZero () ? 1 : -1);
+    if (negative)
+        return Number (0);
+
+    size_t bits = a.Big ? a.Big->bits () : BigInt (a.Small).bits ();
+    if (b.Big || static_cast<unsigned long long> (b.Small) > MaxPowerBits / bits)
+        throw std::runtime_error ("Error: exponent too large");
+    Number result (1);
+    Number base (a);
+    for (unsigned long long e = b.Small; ; )
+    {
+        if (e & 1)
+            result = multiply (result, base);
+        e >>= 1;
+        if (!e)
+            break;
+        base = multiply (base, base);
+    }
+    return result;
+}
+
+std::ostream &operator<< (std::ostream &out, const Number &n)
+{
+    if (n.isSmall ())
+        return out << n.small ();
+    return out << n.toString ();
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+
+#include "BigInt.hpp"
+
+// an integer operand of the evaluator. it lives in a long long and every
+// operation checks for overflow; only a result that doesn't fit is moved
+// into a heap allocated BigInt, and a BigInt result that fits a long long
+// again comes back to the word. arithmetic on small values never allocates.
+class Number
+{
+    private:
+        static const size_t MaxPowerBits = 1 << 26;
+
+        long long   Small;
+        BigInt      *Big;
+
+        static Number fromBig (const BigInt &value);
+        BigInt big () const;
+    public:
+        Number ();
+        Number (long long value);
+        Number (const Number &other);
+        Number &operator= (const Number &obj);
+        ~Number ();
+
+        bool isZero () const;
+        bool isSmall () const;
+        long long small () const;
+        double toDouble () const;
+        std::string toString () const;
+        static Number fromString (const char *begin, const char *end);
+
+        static Number add (const Number &a, const Number &b);
+        static Number subtract (const Number &a, const Number &b);
+        static Number multiply (const Number &a, const Number &b);
+        static Number divide (const Number &a, const Number &b);
+        static Number remainder (const Number &a, const Number &b);
+        static Number power (const Number &a, const Number &b);
+};
+
+std::ostream &operator<< (std::ostream &out, const Number &n);
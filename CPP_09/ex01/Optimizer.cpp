@@ -0,0 +1,254 @@
+#include "Optimizer.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+bool Optimizer::Node::operator< (const Node &other) const
+{
+    if (op != other.op)
+        return op < other.op;
+    if (value != other.value)
+        return value < other.value;
+    if (a != other.a)
+        return a < other.a;
+    return b < other.b;
+}
+
+Optimizer::Optimizer (Mode kind) : Kind (kind)
+{
+    Last.before = Last.after = Last.folded = Last.simplified = Last.shared = 0;
+}
+
+Optimizer::Optimizer (const Optimizer &other)
+    : Kind (other.Kind), Last (other.Last), Nodes (other.Nodes), Safe (other.Safe), Index (other.Index)
+{
+}
+
+Optimizer &Optimizer::operator= (const Optimizer &obj)
+{
+    Kind = obj.Kind;
+    Last = obj.Last;
+    Nodes = obj.Nodes;
+    Safe = obj.Safe;
+    Index = obj.Index;
+    return *this;
+}
+
+Optimizer::~Optimizer ()
+{
+}
+
+// the node for a Push or a Load, the same one every time
+size_t Optimizer::leaf (unsigned char op, long long value)
+{
+    Node node = { op, value, 0, 0 };
+    std::map<Node, size_t>::iterator it = Index.find (node);
+    if (it != Index.end ())
+        return it->second;
+    Nodes.push_back (node);
+    Safe.push_back (true);
+    Index[node] = Nodes.size () - 1;
+    return Nodes.size () - 1;
+}
+
+size_t Optimizer::constant (long long value)
+{
+    return leaf (CompiledRPN::Push, value);
+}
+
+bool Optimizer::isConstant (size_t id, long long value) const
+{
+    return Nodes[id].op == CompiledRPN::Push && Nodes[id].value == value;
+}
+
+// a op b on constants, false when it can't be done at compile time: a
+// division by zero is left for evaluate () to report, and a result past a
+// long long stays an instruction so the immediates remain words. in
+// floating mode only what doubles compute exactly is folded.
+bool Optimizer::fold (unsigned char op, long long a, long long b, long long &out) const
+{
+    if (op == CompiledRPN::Divide && (b == 0 || Kind == Floating))
+        return false;
+    Number result;
+    if (op == CompiledRPN::Add)
+        result = Number::add (a, b);
+    else if (op == CompiledRPN::Subtract)
+        result = Number::subtract (a, b);
+    else if (op == CompiledRPN::Multiply)
+        result = Number::multiply (a, b);
+    else
+        result = Number::divide (a, b);
+    if (!result.isSmall ())
+        return false;
+    out = result.small ();
+    if (Kind == Integer)
+        return true;
+    // doubles would give -0 for a negative times zero, and -0 turns a
+    // later x / 0 into -inf
+    if (out == 0 && op == CompiledRPN::Multiply && (a < 0 || b < 0))
+        return false;
+    return out <= 1LL << 53 && out >= -(1LL << 53);
+}
+
+// the node for a op b after folding and identities. + and * take their
+// operands in id order, so a + b and b + a are the same node.
+size_t Optimizer::combine (unsigned char op, size_t a, size_t b)
+{
+    long long value;
+    if (Nodes[a].op == CompiledRPN::Push && Nodes[b].op == CompiledRPN::Push
+        && fold (op, Nodes[a].value, Nodes[b].value, value))
+    {
+        Last.folded++;
+        return constant (value);
+    }
+
+    bool integer = Kind == Integer;
+    size_t same = Nodes.size ();
+    if (op == CompiledRPN::Add && integer && isConstant (b, 0))
+        same = a;
+    else if (op == CompiledRPN::Add && integer && isConstant (a, 0))
+        same = b;
+    else if (op == CompiledRPN::Subtract && isConstant (b, 0))
+        same = a;
+    else if (op == CompiledRPN::Subtract && integer && a == b && Safe[a])
+        same = constant (0);
+    else if (op == CompiledRPN::Multiply && isConstant (b, 1))
+        same = a;
+    else if (op == CompiledRPN::Multiply && isConstant (a, 1))
+        same = b;
+    else if (op == CompiledRPN::Multiply && integer && isConstant (b, 0) && Safe[a])
+        same = b;
+    else if (op == CompiledRPN::Multiply && integer && isConstant (a, 0) && Safe[b])
+        same = a;
+    else if (op == CompiledRPN::Divide && isConstant (b, 1))
+        same = a;
+    if (same != Nodes.size ())
+    {
+        Last.simplified++;
+        return same;
+    }
+
+    if ((op == CompiledRPN::Add || op == CompiledRPN::Multiply) && b < a)
+        std::swap (a, b);
+    Node node = { op, 0, a, b };
+    std::map<Node, size_t>::iterator it = Index.find (node);
+    if (it != Index.end ())
+        return it->second;
+    bool divides = op == CompiledRPN::Divide
+        && (Nodes[b].op != CompiledRPN::Push || Nodes[b].value == 0);
+    Nodes.push_back (node);
+    Safe.push_back (Safe[a] && Safe[b] && !divides);
+    Index[node] = Nodes.size () - 1;
+    return Nodes.size () - 1;
+}
+
+// post order from the root with an explicit stack, long chains would run
+// out of call stack. an operator reached twice gets a slot the first time
+// it is computed and is recalled from it after that; children always have
+// smaller ids than their parents, so the uses are counted in one sweep down.
+void Optimizer::emit (size_t root, CompiledRPN &out) const
+{
+    std::vector<size_t> uses (Nodes.size (), 0);
+    std::vector<bool> reached (Nodes.size (), false);
+    reached[root] = true;
+    for (size_t id = root + 1; id > 0; id--)
+    {
+        const Node &node = Nodes[id - 1];
+        if (!reached[id - 1] || node.op == CompiledRPN::Push || node.op == CompiledRPN::Load)
+            continue;
+        uses[node.a]++;
+        uses[node.b]++;
+        reached[node.a] = reached[node.b] = true;
+    }
+
+    std::vector<long> slots (Nodes.size (), -1);
+    std::vector<std::pair<size_t, int> > work;
+    size_t depth = 0;
+    work.push_back (std::make_pair (root, 0));
+    while (!work.empty ())
+    {
+        size_t id = work.back ().first;
+        int &state = work.back ().second;
+        const Node &node = Nodes[id];
+        if (state == 0 && slots[id] >= 0)
+        {
+            out.Code.push_back (CompiledRPN::Recall);
+            out.Immediates.push_back (slots[id]);
+        }
+        else if (node.op == CompiledRPN::Push || node.op == CompiledRPN::Load)
+        {
+            out.Code.push_back (node.op);
+            out.Immediates.push_back (node.value);
+        }
+        else if (state < 2)
+        {
+            size_t next = state == 0 ? node.a : node.b;
+            state++;
+            work.push_back (std::make_pair (next, 0));
+            continue;
+        }
+        else
+        {
+            out.Code.push_back (node.op);
+            depth--;
+            if (uses[id] > 1)
+            {
+                slots[id] = out.Slots++;
+                out.Code.push_back (CompiledRPN::Store);
+                out.Immediates.push_back (slots[id]);
+            }
+            work.pop_back ();
+            continue;
+        }
+        if (++depth > out.Depth)
+            out.Depth = depth;
+        work.pop_back ();
+    }
+    out.Code.push_back (CompiledRPN::End);
+}
+
+// the program is replayed on node ids; Store and Recall are followed too,
+// so an optimized program can be run through again.
+CompiledRPN Optimizer::run (const CompiledRPN &program)
+{
+    if (program.Code.empty ())
+        throw std::runtime_error ("Error: invalid expression");
+    Nodes.clear ();
+    Safe.clear ();
+    Index.clear ();
+    Last.folded = Last.simplified = 0;
+
+    std::vector<size_t> stack;
+    std::vector<size_t> slots (program.Slots);
+    const long long *imm = program.Immediates.empty () ? NULL : &program.Immediates[0];
+    for (size_t pc = 0; program.Code[pc] != CompiledRPN::End; pc++)
+    {
+        unsigned char op = program.Code[pc];
+        if (op == CompiledRPN::Push || op == CompiledRPN::Load)
+            stack.push_back (leaf (op, *imm++));
+        else if (op == CompiledRPN::Recall)
+            stack.push_back (slots[*imm++]);
+        else if (op == CompiledRPN::Store)
+            slots[*imm++] = stack.back ();
+        else
+        {
+            size_t b = stack.back ();
+            stack.pop_back ();
+            stack.back () = combine (op, stack.back (), b);
+        }
+    }
+
+    CompiledRPN out;
+    out.Variables = program.Variables;
+    emit (stack.back (), out);
+    Last.before = program.size ();
+    Last.after = out.size ();
+    Last.shared = out.Slots;
+    return out;
+}
+
+const Optimizer::Stats &Optimizer::stats () const
+{
+    return Last;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include "CompiledRPN.hpp"
+
+// rewrites a compiled program into a shorter one with the same values.
+// the instructions are replayed on a stack of node ids to build the
+// expression as a DAG, where equal sub-expressions get the same node.
+// while it is built, operators on two constants are folded, the identities
+// x * 1, x + 0, x - 0 and x / 1 are dropped, and in integer mode x * 0 and
+// x - x become 0 (unless x may divide by zero, that error must still be
+// raised). a node used more than once is computed once, kept with Store
+// and pushed again with Recall.
+//
+// in floating mode the result is meant for the column evaluator: nothing
+// is folded that doubles would compute differently (no division, nothing
+// past 2^53) and x + 0 stays, since -0 + 0 is 0.
+class Optimizer
+{
+    public:
+        enum Mode { Integer, Floating };
+
+        struct Stats
+        {
+            size_t  before;
+            size_t  after;
+            size_t  folded;
+            size_t  simplified;
+            size_t  shared;
+        };
+    private:
+        struct Node
+        {
+            unsigned char   op;
+            long long       value;
+            size_t          a;
+            size_t          b;
+
+            bool operator< (const Node &other) const;
+        };
+
+        Mode                        Kind;
+        Stats                       Last;
+        std::vector<Node>           Nodes;
+        std::vector<bool>           Safe;
+        std::map<Node, size_t>      Index;
+
+        size_t leaf (unsigned char op, long long value);
+        size_t constant (long long value);
+        size_t combine (unsigned char op, size_t a, size_t b);
+        bool isConstant (size_t id, long long value) const;
+        bool fold (unsigned char op, long long a, long long b, long long &out) const;
+        void emit (size_t root, CompiledRPN &out) const;
+    public:
+        Optimizer (Mode kind = Integer);
+        Optimizer (const Optimizer &other);
+        Optimizer &operator= (const Optimizer &obj);
+        ~Optimizer ();
+
+        CompiledRPN run (const CompiledRPN &program);
+        const Stats &stats () const;
+};
@@ -0,0 +1,86 @@
+#include "OutputSink.hpp"
+
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+
+OutputSink::OutputSink (int fd)
+    : Fd (fd), LineBuffered (isatty (fd)), Failed (false), Length (0), Buffer (new char[Capacity])
+{
+}
+
+OutputSink::OutputSink (int fd, bool lineBuffered)
+    : Fd (fd), LineBuffered (lineBuffered), Failed (false), Length (0), Buffer (new char[Capacity])
+{
+}
+
+OutputSink::~OutputSink ()
+{
+    flush ();
+    delete[] Buffer;
+}
+
+// a failed write (closed pipe, full disk) drops the rest of the output
+// quietly, like a stream with badbit set.
+void OutputSink::drain (const char *data, size_t len)
+{
+    while (len > 0 && !Failed)
+    {
+        ssize_t n = ::write (Fd, data, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+        {
+            Failed = true;
+            break;
+        }
+        data += n;
+        len -= n;
+    }
+}
+
+void OutputSink::flush ()
+{
+    if (Length > 0)
+        drain (Buffer, Length);
+    Length = 0;
+}
+
+void OutputSink::write (const char *data, size_t len)
+{
+    if (Length + len > Capacity)
+    {
+        flush ();
+        if (len >= Capacity)
+        {
+            drain (data, len);
+            return;
+        }
+    }
+    memcpy (Buffer + Length, data, len);
+    Length += len;
+}
+
+void OutputSink::write (const char *str)
+{
+    write (str, strlen (str));
+}
+
+void OutputSink::write (const std::string &str)
+{
+    write (str.data (), str.size ());
+}
+
+void OutputSink::put (char c)
+{
+    if (Length == Capacity)
+        flush ();
+    Buffer[Length++] = c;
+}
+
+void OutputSink::newline ()
+{
+    put ('\n');
+    if (LineBuffered)
+        flush ();
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+// buffered writer for the results. bytes collect in a big user space buffer
+// and go out in one write (2) when it fills up, on flush () and in the
+// destructor. a line buffered sink (the default when fd is a terminal) also
+// flushes at every newline ().
+class OutputSink
+{
+    private:
+        static const size_t Capacity = 1 << 16;
+
+        int         Fd;
+        bool        LineBuffered;
+        bool        Failed;
+        size_t      Length;
+        char        *Buffer;
+
+        OutputSink (const OutputSink &other);
+        OutputSink &operator= (const OutputSink &obj);
+
+        void drain (const char *data, size_t len);
+    public:
+        OutputSink (int fd);
+        OutputSink (int fd, bool lineBuffered);
+        ~OutputSink ();
+
+        void write (const char *data, size_t len);
+        void write (const char *str);
+        void write (const std::string &str);
+        void put (char c);
+        void newline ();
+        void flush ();
+};
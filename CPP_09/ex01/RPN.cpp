@@ -1,17 +1,23 @@
 #include "RPN.hpp"
+#include "Scan.hpp"
 
-RPN::RPN ()
+#include <climits>
+#include <stdexcept>
+
+RPN::RPN () : Size (0)
 {
 }
 
-RPN::RPN (const RPN &other)
+RPN::RPN (const RPN &other) : Size (0)
 {
     *this = other;
 }
 
 RPN &RPN::operator= (const RPN &obj)
 {
-    this->st = obj.st;
+    for (size_t i = 0; i < obj.Size; i++)
+        Stack[i] = obj.Stack[i];
+    Size = obj.Size;
     return *this;
 }
 
@@ -19,43 +25,106 @@ RPN::~RPN ()
 {
 }
 
-void RPN::calculate (std::string expression)
+// the fast pass: false if a value or the stack outgrew its words, the
+// errors are thrown as they come, exactly where the slow pass would.
+bool RPN::evaluateWords (const char *begin, const char *end)
 {
-    std::stringstream ss (expression);
-    std::string token;
-    while (ss >> token)
+    const char *cur = begin;
+    const char *token;
+    Size = 0;
+    while (nextToken (cur, end, token))
     {
-        if (token == "+" || token == "-" || token == "*" || token == "/")
+        if (cur - token == 1 && (*token == '+' || *token == '-' || *token == '*' || *token == '/'))
         {
-            if (st.size () < 2)
+            if (Size < 2)
                 throw std::runtime_error ("Error: invalid expression");
-            int b = st.top ();
-            st.pop ();
-            int a = st.top ();
-            st.pop ();
-            if (token == "+")
-                st.push (a + b);
-            else if (token == "-")
-                st.push (a - b);
-            else if (token == "*")
-                st.push (a * b);
-            else if (token == "/")
+            long long b = Stack[--Size];
+            long long &a = Stack[Size - 1];
+            switch (*token)
             {
-                if (b == 0)
-                    throw std::runtime_error ("Error: division by zero");
-                st.push (a / b);
+                case '+':
+                    if (__builtin_add_overflow (a, b, &a))
+                        return false;
+                    break;
+                case '-':
+                    if (__builtin_sub_overflow (a, b, &a))
+                        return false;
+                    break;
+                case '*':
+                    if (__builtin_mul_overflow (a, b, &a))
+                        return false;
+                    break;
+                case '/':
+                    if (b == 0)
+                        throw std::runtime_error ("Error: division by zero");
+                    if (a == LLONG_MIN && b == -1)
+                        return false;
+                    a /= b;
+                    break;
             }
         }
         else
         {
-            std::stringstream convert (token);
             int num;
-            if(!(convert >> num) || !(convert >> std::ws).eof() || num > 9)
+            if (!scanLiteral (token, cur, num) || num > 9)
+                throw std::runtime_error ("Error: invalid token");
+            if (Size == StackSize)
+                return false;
+            Stack[Size++] = num;
+        }
+    }
+    if (Size != 1)
+        throw std::runtime_error ("Error: invalid expression");
+    return true;
+}
+
+// the same walk on Numbers in a growing stack
+Number RPN::evaluateNumbers (const char *begin, const char *end) const
+{
+    std::vector<Number> st;
+    const char *cur = begin;
+    const char *token;
+    while (nextToken (cur, end, token))
+    {
+        if (cur - token == 1 && (*token == '+' || *token == '-' || *token == '*' || *token == '/'))
+        {
+            if (st.size () < 2)
+                throw std::runtime_error ("Error: invalid expression");
+            Number b = st.back ();
+            st.pop_back ();
+            Number &a = st.back ();
+            if (*token == '+')
+                a = Number::add (a, b);
+            else if (*token == '-')
+                a = Number::subtract (a, b);
+            else if (*token == '*')
+                a = Number::multiply (a, b);
+            else
+                a = Number::divide (a, b);
+        }
+        else
+        {
+            int num;
+            if (!scanLiteral (token, cur, num) || num > 9)
                 throw std::runtime_error ("Error: invalid token");
-            st.push (num);
+            st.push_back (Number (num));
         }
     }
     if (st.size () != 1)
         throw std::runtime_error ("Error: invalid expression");
-    std::cout << st.top () << std::endl;
-}
\ No newline at end of file
+    return st.back ();
+}
+
+// every evaluation starts on an empty stack
+Number RPN::evaluate (const char *begin, const char *end)
+{
+    if (evaluateWords (begin, end))
+        return Number (Stack[0]);
+    return evaluateNumbers (begin, end);
+}
+
+void RPN::calculate (std::string expression)
+{
+    const char *text = expression.data ();
+    std::cout << evaluate (text, text + expression.size ()) << std::endl;
+}
@@ -1,19 +1,31 @@
 #pragma once
 
 #include <iostream>
-#include <stack>
-#include <sstream>
+#include <string>
+#include <vector>
 
+#include "Number.hpp"
+
+// evaluates an expression in one pass over its text. the stack is a fixed
+// array of words inside the object, so nothing is allocated while the
+// values fit in a long long and the stack in StackSize entries; past that
+// the expression is evaluated again from the start on Numbers.
 class RPN
 {
     private:
-        std::stack<int>  st;
+        static const size_t StackSize = 256;
+
+        long long   Stack[StackSize];
+        size_t      Size;
+
+        bool evaluateWords (const char *begin, const char *end);
+        Number evaluateNumbers (const char *begin, const char *end) const;
     public:
         RPN ();
         RPN (const RPN &other);
         RPN &operator= (const RPN &obj);
         ~RPN ();
 
-
+        Number evaluate (const char *begin, const char *end);
         void calculate (std::string expression);
-};
\ No newline at end of file
+};
@@ -0,0 +1,48 @@
+#include "Scan.hpp"
+
+#include <climits>
+
+// the characters `ss >> token` stops at
+bool isSpace (char c)
+{
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+// skips blanks, then leaves the next token in [begin, cur). false when
+// only blanks are left.
+bool nextToken (const char *&cur, const char *end, const char *&begin)
+{
+    while (cur < end && isSpace (*cur))
+        cur++;
+    if (cur == end)
+        return false;
+    begin = cur;
+    while (cur < end && !isSpace (*cur))
+        cur++;
+    return true;
+}
+
+// what `convert >> num` on a whole token accepted: a sign, then digits,
+// all of it, in the range of an int. RPN still wants num <= 9 on top.
+bool scanLiteral (const char *begin, const char *end, int &value)
+{
+    const char *p = begin;
+    bool negative = false;
+    if (p < end && (*p == '+' || *p == '-'))
+        negative = *p++ == '-';
+    if (p == end)
+        return false;
+    long long mag = 0;
+    for (; p < end; p++)
+    {
+        if (*p < '0' || *p > '9')
+            return false;
+        mag = mag * 10 + (*p - '0');
+        if (mag > static_cast<long long> (INT_MAX) + 1)
+            return false;
+    }
+    if (!negative && mag > INT_MAX)
+        return false;
+    value = static_cast<int> (negative ? -mag : mag);
+    return true;
+}
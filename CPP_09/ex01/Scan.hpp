@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstddef>
+
+// allocation free tokenizer shared by RPN::calculate and CompiledRPN. it
+// walks the raw text, tokens are [begin, cur) ranges into it.
+
+bool isSpace (char c);
+bool nextToken (const char *&cur, const char *end, const char *&begin);
+bool scanLiteral (const char *begin, const char *end, int &value);
@@ -0,0 +1,193 @@
+#include "Value.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+Value::Value () : Real (0), Floating (false)
+{
+}
+
+Value::Value (const Number &value) : Exact (value), Real (0), Floating (false)
+{
+}
+
+Value::Value (double value) : Real (value), Floating (true)
+{
+}
+
+Value::Value (const Value &other) : Exact (other.Exact), Real (other.Real), Floating (other.Floating)
+{
+}
+
+Value &Value::operator= (const Value &obj)
+{
+    Exact = obj.Exact;
+    Real = obj.Real;
+    Floating = obj.Floating;
+    return *this;
+}
+
+Value::~Value ()
+{
+}
+
+bool Value::isFloating () const
+{
+    return Floating;
+}
+
+const Number &Value::exact () const
+{
+    return Exact;
+}
+
+double Value::toDouble () const
+{
+    return Floating ? Real : Exact.toDouble ();
+}
+
+// integers in full, doubles with the fewest digits that read back as the
+// same double
+std::string Value::toString () const
+{
+    if (!Floating)
+        return Exact.toString ();
+    char buf[32];
+    for (int precision = 15; precision <= 17; precision++)
+    {
+        snprintf (buf, sizeof (buf), "%.*g", precision, Real);
+        if (strtod (buf, NULL) == Real)
+            break;
+    }
+    return buf;
+}
+
+// [+-]digits is an exact integer of any length. digits with a fraction
+// and / or an exponent, like 2.5, .5, 1e9 or 3.0e-2, is a double; strtod
+// alone would also take inf, nan and hex, which aren't literals here.
+// one too large for a double is an error, not an infinity.
+bool Value::parse (const char *begin, const char *end, Value &out)
+{
+    const char *p = begin;
+    if (p < end && (*p == '+' || *p == '-'))
+        p++;
+    const char *digits = p;
+    while (p < end && *p >= '0' && *p <= '9')
+        p++;
+    if (p == end)
+    {
+        if (digits == end)
+            return false;
+        out = Value (Number::fromString (begin, end));
+        return true;
+    }
+
+    bool mantissa = p > digits;
+    if (*p == '.')
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++)
+            mantissa = true;
+    if (!mantissa)
+        return false;
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        p++;
+        if (p < end && (*p == '+' || *p == '-'))
+            p++;
+        if (p == end)
+            return false;
+        while (p < end && *p >= '0' && *p <= '9')
+            p++;
+    }
+    if (p != end)
+        return false;
+    // strtod wants a terminated string, short literals are copied on the stack
+    char local[64];
+    double real;
+    if (end - begin < static_cast<long> (sizeof (local)))
+    {
+        memcpy (local, begin, end - begin);
+        local[end - begin] = '\0';
+        real = strtod (local, NULL);
+    }
+    else
+        real = strtod (std::string (begin, end).c_str (), NULL);
+    if (real - real != 0)
+        throw std::runtime_error ("Error: number out of range");
+    out = Value (real);
+    return true;
+}
+
+// a double result has to be a number: a nan (-1 0.5 ^) is a domain error
+// and an infinity an overflow, like a zero divisor they end the expression
+static Value checked (double x)
+{
+    if (x != x)
+        throw std::runtime_error ("Error: result is not a number");
+    if (x - x != 0)
+        throw std::runtime_error ("Error: result out of range");
+    return Value (x);
+}
+
+Value Value::add (const Value &a, const Value &b)
+{
+    if (a.Floating || b.Floating)
+        return checked (a.toDouble () + b.toDouble ());
+    return Value (Number::add (a.Exact, b.Exact));
+}
+
+Value Value::subtract (const Value &a, const Value &b)
+{
+    if (a.Floating || b.Floating)
+        return checked (a.toDouble () - b.toDouble ());
+    return Value (Number::subtract (a.Exact, b.Exact));
+}
+
+Value Value::multiply (const Value &a, const Value &b)
+{
+    if (a.Floating || b.Floating)
+        return checked (a.toDouble () * b.toDouble ());
+    return Value (Number::multiply (a.Exact, b.Exact));
+}
+
+// a zero divisor is an error in doubles too, like everywhere else in RPN
+Value Value::divide (const Value &a, const Value &b)
+{
+    if (!a.Floating && !b.Floating)
+        return Value (Number::divide (a.Exact, b.Exact));
+    if (b.toDouble () == 0)
+        throw std::runtime_error ("Error: division by zero");
+    return checked (a.toDouble () / b.toDouble ());
+}
+
+Value Value::remainder (const Value &a, const Value &b)
+{
+    if (!a.Floating && !b.Floating)
+        return Value (Number::remainder (a.Exact, b.Exact));
+    if (b.toDouble () == 0)
+        throw std::runtime_error ("Error: division by zero");
+    return checked (fmod (a.toDouble (), b.toDouble ()));
+}
+
+Value Value::power (const Value &a, const Value &b)
+{
+    if (a.Floating || b.Floating)
+        return checked (pow (a.toDouble (), b.toDouble ()));
+    return Value (Number::power (a.Exact, b.Exact));
+}
+
+Value Value::negate (const Value &a)
+{
+    if (a.Floating)
+        return Value (-a.Real);
+    return Value (Number::subtract (Number (0), a.Exact));
+}
+
+std::ostream &operator<< (std::ostream &out, const Value &v)
+{
+    if (!v.isFloating () && v.exact ().isSmall ())
+        return out << v.exact ().small ();
+    return out << v.toString ();
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+
+#include "Number.hpp"
+
+// an operand of the extended syntax: an exact integer as long as only
+// integers went into it, a double as soon as a floating literal did. an
+// operator on two integers stays exact (/ and % truncate, ^ with a
+// negative exponent too), an operator with a double operand is computed
+// in doubles.
+class Value
+{
+    private:
+        Number  Exact;
+        double  Real;
+        bool    Floating;
+    public:
+        Value ();
+        Value (const Number &value);
+        Value (double value);
+        Value (const Value &other);
+        Value &operator= (const Value &obj);
+        ~Value ();
+
+        bool isFloating () const;
+        const Number &exact () const;
+        double toDouble () const;
+        std::string toString () const;
+        static bool parse (const char *begin, const char *end, Value &out);
+
+        static Value add (const Value &a, const Value &b);
+        static Value subtract (const Value &a, const Value &b);
+        static Value multiply (const Value &a, const Value &b);
+        static Value divide (const Value &a, const Value &b);
+        static Value remainder (const Value &a, const Value &b);
+        static Value power (const Value &a, const Value &b);
+        static Value negate (const Value &a);
+};
+
+std::ostream &operator<< (std::ostream &out, const Value &v);
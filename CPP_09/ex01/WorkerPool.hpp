@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <pthread.h>
+
+#include "OutputSink.hpp"
+
+// runs count independent jobs on a few threads and writes their output in
+// job order. at most window jobs are done or in flight ahead of the writer,
+// so a slow consumer doesn't let finished output pile up.
+class WorkerPool
+{
+    public:
+        class Job
+        {
+            public:
+                virtual ~Job () {}
+                // fills out for job index. a thrown exception still writes
+                // what is in out, then stops the run with its message.
+                virtual void run (size_t index, std::string &out) = 0;
+        };
+
+        WorkerPool (size_t threads, size_t window);
+        ~WorkerPool ();
+
+        void run (Job &job, size_t count, OutputSink &out);
+
+        static size_t defaultThreads ();
+    private:
+        struct Slot
+        {
+            bool        done;
+            bool        failed;
+            std::string out;
+            std::string error;
+        };
+
+        size_t              Threads;
+        size_t              Window;
+        std::vector<Slot>   Slots;
+        Job                 *Current;
+        size_t              Count;
+        size_t              Next;
+        size_t              Written;
+        bool                Stop;
+        pthread_mutex_t     Lock;
+        pthread_cond_t      JobReady;
+        pthread_cond_t      SlotFree;
+
+        WorkerPool (const WorkerPool &other);
+        WorkerPool &operator= (const WorkerPool &obj);
+
+        void work ();
+        static void *start (void *self);
+};
@@ -0,0 +1,130 @@
+#include "../RPN.hpp"
+
+#include <iostream>
+#include <sstream>
+#include <stack>
+#include <string>
+#include <stdexcept>
+#include <cstdlib>
+#include <sys/time.h>
+
+// throughput of RPN::evaluate against the stringstream / std::stack<int>
+// evaluator it replaced, over one generated expression evaluated again
+// and again.
+// usage: ./rpn_bench [tokens] [runs]
+
+static double now ()
+{
+    struct timeval tv;
+    gettimeofday (&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+// pushes and + - in an order that keeps the values small and the stack
+// a few entries deep
+static std::string generate (long tokens)
+{
+    static const char ops[] = "+-";
+    std::string expr = "5";
+    long depth = 1;
+    srand (42);
+    for (long i = 1; i < tokens; i++)
+    {
+        if (depth >= 2 && (rand () % 2 || depth > 8))
+        {
+            expr += ' ';
+            expr += ops[rand () % 2];
+            depth--;
+        }
+        else
+        {
+            expr += ' ';
+            expr += static_cast<char> ('0' + rand () % 10);
+            depth++;
+        }
+    }
+    while (depth-- > 1)
+        expr += " +";
+    return expr;
+}
+
+static int legacyCalculate (const std::string &expression)
+{
+    std::stack<int> st;
+    std::stringstream ss (expression);
+    std::string token;
+    while (ss >> token)
+    {
+        if (token == "+" || token == "-" || token == "*" || token == "/")
+        {
+            if (st.size () < 2)
+                throw std::runtime_error ("Error: invalid expression");
+            int b = st.top ();
+            st.pop ();
+            int a = st.top ();
+            st.pop ();
+            if (token == "+")
+                st.push (a + b);
+            else if (token == "-")
+                st.push (a - b);
+            else if (token == "*")
+                st.push (a * b);
+            else if (token == "/")
+            {
+                if (b == 0)
+                    throw std::runtime_error ("Error: division by zero");
+                st.push (a / b);
+            }
+        }
+        else
+        {
+            std::stringstream convert (token);
+            int num;
+            if (!(convert >> num) || !(convert >> std::ws).eof () || num > 9)
+                throw std::runtime_error ("Error: invalid token");
+            st.push (num);
+        }
+    }
+    if (st.size () != 1)
+        throw std::runtime_error ("Error: invalid expression");
+    return st.top ();
+}
+
+int main (int argc, char **argv)
+{
+    long tokens = argc > 1 ? atol (argv[1]) : 100000;
+    int runs = argc > 2 ? atoi (argv[2]) : 20;
+    std::string expr = generate (tokens);
+    const char *text = expr.data ();
+
+    RPN rpn;
+    double best = 1e30;
+    Number result;
+    for (int run = 0; run < runs; run++)
+    {
+        double start = now ();
+        result = rpn.evaluate (text, text + expr.size ());
+        double t = now () - start;
+        if (t < best)
+            best = t;
+    }
+
+    double legacyBest = 1e30;
+    int legacy = 0;
+    for (int run = 0; run < (runs + 3) / 4; run++)
+    {
+        double start = now ();
+        legacy = legacyCalculate (expr);
+        double t = now () - start;
+        if (t < legacyBest)
+            legacyBest = t;
+    }
+
+    std::cout << "expression: " << tokens << " tokens, " << expr.size () << " bytes" << std::endl;
+    std::cout << "evaluate:   " << result << " in " << best * 1000 << " ms, "
+              << tokens / best / 1e6 << " Mtokens/s" << std::endl;
+    std::cout << "legacy:     " << legacy << " in " << legacyBest * 1000 << " ms, "
+              << tokens / legacyBest / 1e6 << " Mtokens/s" << std::endl;
+    std::cout << "speedup:    " << legacyBest / best << "x" << std::endl;
+    return 0;
+}
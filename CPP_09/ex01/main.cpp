@@ -1,17 +1,258 @@
 #include "RPN.hpp"
+#include "CompiledRPN.hpp"
+#include "Optimizer.hpp"
+#include "BatchRunner.hpp"
+#include "ExtendedRPN.hpp"
 
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <vector>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+static int usage (const char *name)
+{
+    std::cerr << "Usage: " << name << " [-O] <expression> [name=value ...]" << std::endl;
+    std::cerr << "       " << name << " [-O] -c columns.csv <expression>" << std::endl;
+    std::cerr << "       " << name << " [-j threads] -f file|-" << std::endl;
+    std::cerr << "       " << name << " -x <expression>" << std::endl;
+    std::cerr << "       " << name << " -x -s file|-" << std::endl;
+    return 1;
+}
+
+// a thread count: the whole argument is a number, 0 and up
+static bool parseThreads (const char *text, size_t &threads)
+{
+    char *end;
+    errno = 0;
+    long n = strtol (text, &end, 10);
+    if (end == text || *end || n < 0 || errno == ERANGE)
+        return false;
+    threads = n;
+    return true;
+}
+
+// the program after the Optimizer, with what it saved on stderr
+static CompiledRPN optimize (const CompiledRPN &program, Optimizer::Mode mode)
+{
+    Optimizer optimizer (mode);
+    CompiledRPN out = optimizer.run (program);
+    const Optimizer::Stats &stats = optimizer.stats ();
+    std::cerr << "optimized: " << stats.before << " -> " << stats.after << " instructions ("
+              << stats.folded << " folded, " << stats.simplified << " simplified, "
+              << stats.shared << " shared)" << std::endl;
+    return out;
+}
+
+// name=value pairs for the variables of the expression
+static void evaluateBound (const CompiledRPN &program, int argc, char **argv)
+{
+    std::vector<long long> values (program.variables ());
+    std::vector<bool> bound (program.variables ());
+    for (int i = 0; i < argc; i++)
+    {
+        const char *eq = strchr (argv[i], '=');
+        if (!eq)
+            throw std::runtime_error ("Error: invalid binding");
+        long index = program.find (std::string (argv[i], eq - argv[i]));
+        char *end;
+        errno = 0;
+        long long value = strtoll (eq + 1, &end, 10);
+        if (index < 0 || eq[1] == '\0' || *end != '\0' || errno == ERANGE)
+            throw std::runtime_error ("Error: invalid binding");
+        values[index] = value;
+        bound[index] = true;
+    }
+    for (size_t i = 0; i < values.size (); i++)
+        if (!bound[i])
+            throw std::runtime_error ("Error: unbound variable " + program.variable (i));
+    std::cout << program.evaluate (values.empty () ? NULL : &values[0]) << std::endl;
+}
+
+// a csv with the variable names on its first line and one binding per
+// line after it. prints the value of the expression for every line.
+static void evaluateColumns (const CompiledRPN &program, const char *fileName)
+{
+    std::ifstream file (fileName);
+    std::string line;
+    if (!file.is_open () || !std::getline (file, line))
+        throw std::runtime_error ("Error: could not open file");
+
+    std::vector<long> fields;
+    std::stringstream header (line);
+    std::string name;
+    while (std::getline (header, name, ','))
+        fields.push_back (program.find (name));
+    std::vector<std::vector<double> > columns (program.variables ());
+    for (size_t i = 0; i < columns.size (); i++)
+        if (std::find (fields.begin (), fields.end (), static_cast<long> (i)) == fields.end ())
+            throw std::runtime_error ("Error: unbound variable " + program.variable (i));
+
+    size_t rows = 0;
+    while (std::getline (file, line))
+    {
+        const char *cur = line.c_str ();
+        for (size_t f = 0; f < fields.size (); f++)
+        {
+            char *end;
+            double value = strtod (cur, &end);
+            if (end == cur || *end != (f + 1 < fields.size () ? ',' : '\0'))
+                throw std::runtime_error ("Error: invalid row " + line);
+            if (fields[f] >= 0)
+                columns[fields[f]].push_back (value);
+            cur = end + 1;
+        }
+        rows++;
+    }
+
+    std::vector<const double *> pointers (columns.size ());
+    for (size_t i = 0; i < columns.size (); i++)
+        pointers[i] = rows ? &columns[i][0] : NULL;
+    std::vector<double> out (rows);
+    if (rows)
+        program.evaluate (pointers.empty () ? NULL : &pointers[0], rows, &out[0]);
+    for (size_t i = 0; i < rows; i++)
+        std::cout << out[i] << '\n';
+    std::cout.flush ();
+}
+
+// one expression per line of the file (- for stdin), each answered on its
+// own line, on threads cpus (0 for all of them).
+static int evaluateFile (const char *fileName, size_t threads)
+{
+    int fd = std::string (fileName) == "-" ? STDIN_FILENO : open (fileName, O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error ("Error: could not open file");
+    OutputSink out (STDOUT_FILENO);
+    BatchRunner runner (threads ? threads : WorkerPool::defaultThreads ());
+    bool ok;
+    try
+    {
+        ok = runner.run (fd, out);
+    }
+    catch (...)
+    {
+        if (fd != STDIN_FILENO)
+            close (fd);
+        throw;
+    }
+    if (fd != STDIN_FILENO)
+        close (fd);
+    return ok ? 0 : 1;
+}
+
+// the extended syntax on one expression read in pieces from the whole
+// file (- for stdin), newlines are blanks like any other
+static void evaluateStream (const char *fileName)
+{
+    int fd = std::string (fileName) == "-" ? STDIN_FILENO : open (fileName, O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error ("Error: could not open file");
+    ExtendedRPN rpn;
+    Value result;
+    try
+    {
+        result = rpn.evaluate (fd);
+    }
+    catch (...)
+    {
+        if (fd != STDIN_FILENO)
+            close (fd);
+        throw;
+    }
+    if (fd != STDIN_FILENO)
+        close (fd);
+    std::cout << result << std::endl;
+}
+
+// usage: RPN [-O] <expression>
+//        RPN [-O] <expression> name=value ...
+//        RPN [-O] -c columns.csv <expression>
+//        RPN [-j threads] -f file|-
+//        RPN -x <expression>
+//        RPN -x -s file|-
+// an expression with variables needs a value for each of them, either from
+// the command line or as a column of the csv (all rows at once, in doubles).
+// -O compiles the expression, optimizes it and evaluates the result.
+// -f evaluates a file of expressions, one per line, in parallel; a line
+// that fails prints its error in place and the exit status is 1.
+// -j sets the threads for -f, 0 (the default) means one per cpu, and at
+//    most 4 per cpu are used.
+// -x switches to the extended syntax of ExtendedRPN, -s streams a single
+// expression of any size from a file.
 int main (int argc, char **argv)
 {
-    if (argc != 2)
+    const char *name = argv[0];
+    if (argc > 1 && std::string (argv[1]) == "-x")
     {
-        std::cerr << "Usage: " << argv[0] << " <expression>" << std::endl;
-        return 1;
+        if (argc != 3 && !(argc == 4 && std::string (argv[2]) == "-s"))
+            return usage (name);
+        try
+        {
+            if (argc == 4)
+                evaluateStream (argv[3]);
+            else
+            {
+                ExtendedRPN rpn;
+                rpn.calculate (argv[2]);
+            }
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << e.what () << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    bool optimized = argc > 1 && std::string (argv[1]) == "-O";
+    if (optimized)
+    {
+        argv++;
+        argc--;
+    }
+    size_t threads = 1;
+    int first = 1;
+    if (argc > 2 && std::string (argv[1]) == "-j")
+    {
+        if (!parseThreads (argv[2], threads))
+            return usage (name);
+        first = 3;
+    }
+    if (!optimized && argc - first == 2 && std::string (argv[first]) == "-f")
+    {
+        try
+        {
+            return evaluateFile (argv[first + 1], threads);
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << e.what () << std::endl;
+            return 1;
+        }
     }
+    if (first != 1 || argc < 2 || (std::string (argv[1]) == "-c" && argc != 4)
+        || (optimized && std::string (argv[1]) == "-f"))
+        return usage (name);
 
     try
     {
-        RPN rpn;
-        rpn.calculate (argv[1]);
+        if (std::string (argv[1]) == "-c" && optimized)
+            evaluateColumns (optimize (CompiledRPN (argv[3]), Optimizer::Floating), argv[2]);
+        else if (std::string (argv[1]) == "-c")
+            evaluateColumns (CompiledRPN (argv[3]), argv[2]);
+        else if (optimized)
+            evaluateBound (optimize (CompiledRPN (argv[1]), Optimizer::Integer), argc - 2, argv + 2);
+        else if (argc > 2)
+            evaluateBound (CompiledRPN (argv[1]), argc - 2, argv + 2);
+        else
+        {
+            RPN rpn;
+            rpn.calculate (argv[1]);
+        }
     }
     catch (const std::exception &e)
     {
@@ -19,4 +260,4 @@ int main (int argc, char **argv)
         return 1;
     }
     return 0;
-}
\ No newline at end of file
+}
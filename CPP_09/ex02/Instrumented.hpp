@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+
+#include "MergeInsertion.hpp"
+
+// what one sort run cost. comparisons are counted by CountingLess, moves
+// (copy constructions and assignments, C++98 has no other kind) by
+// Tracked elements, and allocations by whoever hooks operator new (the
+// bench does), since the sort's own buffers don't go through the element.
+struct SortCounters
+{
+    unsigned long   comparisons;
+    unsigned long   moves;
+    unsigned long   allocations;
+
+    SortCounters () : comparisons (0), moves (0), allocations (0) {}
+};
+
+// less, counted into *counters, also from several threads
+template <typename Compare>
+class CountingLess
+{
+    private:
+        Compare         Less;
+        SortCounters    *Counters;
+    public:
+        CountingLess (SortCounters *counters, Compare less = Compare ()) : Less (less), Counters (counters) {}
+        CountingLess (const CountingLess &other) : Less (other.Less), Counters (other.Counters) {}
+        CountingLess &operator= (const CountingLess &obj)
+        {
+            Less = obj.Less;
+            Counters = obj.Counters;
+            return *this;
+        }
+        ~CountingLess () {}
+
+        template <typename T>
+        bool operator() (const T &a, const T &b) const
+        {
+            __atomic_add_fetch (&Counters->comparisons, 1, __ATOMIC_RELAXED);
+            return Less (a, b);
+        }
+};
+
+// a value that counts every copy of itself into Tracked<T>::counters
+template <typename T>
+class Tracked
+{
+    private:
+        T   Value;
+    public:
+        static SortCounters *counters;
+
+        Tracked () : Value () {}
+        Tracked (const T &value) : Value (value) {}
+        Tracked (const Tracked &other) : Value (other.Value)
+        {
+            if (counters)
+                __atomic_add_fetch (&counters->moves, 1, __ATOMIC_RELAXED);
+        }
+        Tracked &operator= (const Tracked &obj)
+        {
+            if (counters)
+                __atomic_add_fetch (&counters->moves, 1, __ATOMIC_RELAXED);
+            Value = obj.Value;
+            return *this;
+        }
+        ~Tracked () {}
+
+        const T &value () const { return Value; }
+        bool operator< (const Tracked &other) const { return Value < other.Value; }
+};
+
+template <typename T>
+SortCounters *Tracked<T>::counters = NULL;
+
+// a tracked scalar takes the same path through mergeInsertionSort as the
+// scalar itself, so the moves counted are the ones a plain sort makes
+template <typename T>
+struct IsScalar<Tracked<T> >
+{
+    static const bool value = IsScalar<T>::value;
+};
+
+// F(n), the comparisons merge-insertion needs at most for n elements:
+// the sum over k <= n of ceil (log2 (3k / 4))
+inline unsigned long fordJohnsonBound (size_t n)
+{
+    unsigned long total = 0;
+    for (size_t k = 1; k <= n; k++)
+    {
+        unsigned long e = 0;
+        while ((4UL << e) < 3 * k)
+            e++;
+        total += e;
+    }
+    return total;
+}
@@ -0,0 +1,265 @@
+#include "MergeChain.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+MergeChain::MergeChain () : Block (MinBlock), Blocks (0), Count (0)
+{
+}
+
+MergeChain::MergeChain (const MergeChain &other)
+    : Slots (other.Slots), Sizes (other.Sizes), Order (other.Order), Position (other.Position),
+      Tree (other.Tree), Where (other.Where), Block (other.Block), Blocks (other.Blocks), Count (other.Count)
+{
+}
+
+MergeChain &MergeChain::operator= (const MergeChain &obj)
+{
+    Slots = obj.Slots;
+    Sizes = obj.Sizes;
+    Order = obj.Order;
+    Position = obj.Position;
+    Tree = obj.Tree;
+    Where = obj.Where;
+    Block = obj.Block;
+    Blocks = obj.Blocks;
+    Count = obj.Count;
+    return *this;
+}
+
+MergeChain::~MergeChain ()
+{
+}
+
+int *MergeChain::block (size_t physical)
+{
+    return &Slots[physical * 2 * Block];
+}
+
+const int *MergeChain::block (size_t physical) const
+{
+    return &Slots[physical * 2 * Block];
+}
+
+// empties the chain for at most capacity items. blocks of about the square
+// root of it balance the shifting inside a block against the splits; there
+// are never more than capacity / Block + 2 of them.
+void MergeChain::reset (size_t capacity)
+{
+    Block = static_cast<size_t> (std::sqrt (static_cast<double> (capacity)));
+    if (Block < MinBlock)
+        Block = MinBlock;
+    size_t blocks = capacity / Block + 2;
+    if (Slots.size () < blocks * 2 * Block)
+        Slots.resize (blocks * 2 * Block);
+    if (Sizes.size () < blocks)
+    {
+        Sizes.resize (blocks);
+        Order.resize (blocks);
+        Position.resize (blocks);
+        Tree.resize (blocks + 1);
+    }
+    if (Where.size () < capacity)
+        Where.resize (capacity);
+    Blocks = 0;
+    Count = 0;
+}
+
+// Tree[i] holds the sizes of the logical blocks (i - (i & -i), i]
+void MergeChain::add (size_t logical, size_t delta)
+{
+    for (size_t i = logical + 1; i <= Blocks; i += i & (0 - i))
+        Tree[i] += delta;
+}
+
+// items in the logical blocks before logical
+size_t MergeChain::prefix (size_t logical) const
+{
+    size_t sum = 0;
+    for (size_t i = logical; i > 0; i -= i & (0 - i))
+        sum += Tree[i];
+    return sum;
+}
+
+// the logical block holding rank, and the rank inside it. rank == size ()
+// is the end of the last block.
+size_t MergeChain::locate (size_t rank, size_t &offset) const
+{
+    if (rank == Count)
+    {
+        offset = Sizes[Order[Blocks - 1]];
+        return Blocks - 1;
+    }
+    size_t step = 1;
+    while (step * 2 <= Blocks)
+        step *= 2;
+    size_t logical = 0;
+    for (; step; step /= 2)
+        if (logical + step <= Blocks && Tree[logical + step] <= rank)
+        {
+            logical += step;
+            rank -= Tree[logical];
+        }
+    offset = rank;
+    return logical;
+}
+
+void MergeChain::rebuild ()
+{
+    for (size_t i = 1; i <= Blocks; i++)
+        Tree[i] = 0;
+    for (size_t i = 0; i < Blocks; i++)
+    {
+        Position[Order[i]] = i;
+        size_t parent = i + 1 + ((i + 1) & (0 - (i + 1)));
+        Tree[i + 1] += Sizes[Order[i]];
+        if (parent <= Blocks)
+            Tree[parent] += Tree[i + 1];
+    }
+}
+
+// the upper half of a full block moves to a new block right after it
+void MergeChain::split (size_t logical)
+{
+    size_t from = Order[logical];
+    size_t to = Blocks++;
+    memcpy (block (to), block (from) + Block, Block * sizeof (int));
+    for (size_t i = 0; i < Block; i++)
+        Where[block (to)[i]] = to;
+    Sizes[from] = Block;
+    Sizes[to] = Block;
+    for (size_t i = Blocks - 1; i > logical + 1; i--)
+        Order[i] = Order[i - 1];
+    Order[logical + 1] = to;
+    rebuild ();
+}
+
+// fills the chain in order, Block items per block
+void MergeChain::append (int item)
+{
+    if (Blocks == 0 || Sizes[Order[Blocks - 1]] == Block)
+    {
+        Order[Blocks] = Blocks;
+        Position[Blocks] = Blocks;
+        Sizes[Blocks] = 0;
+        Tree[Blocks + 1] = 0;
+        Blocks++;
+        size_t below = Blocks - (Blocks & (0 - Blocks));
+        for (size_t i = Blocks - 1; i > below; i -= i & (0 - i))
+            Tree[Blocks] += Tree[i];
+    }
+    size_t physical = Order[Blocks - 1];
+    block (physical)[Sizes[physical]++] = item;
+    Where[item] = physical;
+    add (Blocks - 1, 1);
+    Count++;
+}
+
+// item goes in front of the one now at rank
+void MergeChain::insert (size_t rank, int item)
+{
+    if (Blocks == 0)
+    {
+        append (item);
+        return;
+    }
+    size_t offset;
+    size_t logical = locate (rank, offset);
+    size_t physical = Order[logical];
+    int *items = block (physical);
+    memmove (items + offset + 1, items + offset, (Sizes[physical] - offset) * sizeof (int));
+    items[offset] = item;
+    Where[item] = physical;
+    Sizes[physical]++;
+    add (logical, 1);
+    Count++;
+    if (Sizes[physical] == 2 * Block)
+        split (logical);
+}
+
+size_t MergeChain::size () const
+{
+    return Count;
+}
+
+int MergeChain::at (size_t rank) const
+{
+    size_t offset;
+    size_t logical = locate (rank, offset);
+    return block (Order[logical])[offset];
+}
+
+size_t MergeChain::rank (int item) const
+{
+    size_t physical = Where[item];
+    const int *items = block (physical);
+    size_t offset = 0;
+    while (items[offset] != item)
+        offset++;
+    return prefix (Position[physical]) + offset;
+}
+
+void MergeChain::copyTo (int *out) const
+{
+    for (size_t i = 0; i < Blocks; i++)
+    {
+        size_t physical = Order[i];
+        memcpy (out, block (physical), Sizes[physical] * sizeof (int));
+        out += Sizes[physical];
+    }
+}
+
+ShiftChain::ShiftChain ()
+{
+}
+
+ShiftChain::ShiftChain (const ShiftChain &other) : Items (other.Items)
+{
+}
+
+ShiftChain &ShiftChain::operator= (const ShiftChain &obj)
+{
+    Items = obj.Items;
+    return *this;
+}
+
+ShiftChain::~ShiftChain ()
+{
+}
+
+void ShiftChain::reset (size_t capacity)
+{
+    Items.clear ();
+    Items.reserve (capacity);
+}
+
+void ShiftChain::append (int item)
+{
+    Items.push_back (item);
+}
+
+void ShiftChain::insert (size_t rank, int item)
+{
+    Items.insert (Items.begin () + rank, item);
+}
+
+size_t ShiftChain::size () const
+{
+    return Items.size ();
+}
+
+int ShiftChain::at (size_t rank) const
+{
+    return Items[rank];
+}
+
+size_t ShiftChain::rank (int item) const
+{
+    return std::find (Items.begin (), Items.end (), item) - Items.begin ();
+}
+
+void ShiftChain::copyTo (int *out) const
+{
+    std::copy (Items.begin (), Items.end (), out);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// the main chain of one merge-insertion level, in two forms with the same
+// interface: MergeChain for long chains and ShiftChain for short ones.
+//
+// MergeChain: a sequence of item numbers (0 to capacity - 1, each at most
+// once) read and grown by rank. it is cut into blocks of Block to 2 * Block items, so an insertion only shifts
+// the items of one block, and a Fenwick tree over the block sizes in chain
+// order turns a rank into a block in O(log blocks). a full block is split
+// in two. Where remembers the block of every item, for rank ().
+//
+// all storage is sized by reset () and only ever grows, so resetting for
+// the largest level first allocates once for the whole sort.
+class MergeChain
+{
+    private:
+        static const size_t MinBlock = 16;
+
+        std::vector<int>    Slots;
+        std::vector<size_t> Sizes;
+        std::vector<size_t> Order;
+        std::vector<size_t> Position;
+        std::vector<size_t> Tree;
+        std::vector<size_t> Where;
+        size_t              Block;
+        size_t              Blocks;
+        size_t              Count;
+
+        int *block (size_t physical);
+        const int *block (size_t physical) const;
+        void add (size_t logical, size_t delta);
+        size_t prefix (size_t logical) const;
+        size_t locate (size_t rank, size_t &offset) const;
+        void rebuild ();
+        void split (size_t logical);
+    public:
+        MergeChain ();
+        MergeChain (const MergeChain &other);
+        MergeChain &operator= (const MergeChain &obj);
+        ~MergeChain ();
+
+        void reset (size_t capacity);
+        void append (int item);
+        void insert (size_t rank, int item);
+
+        size_t size () const;
+        int at (size_t rank) const;
+        size_t rank (int item) const;
+        void copyTo (int *out) const;
+};
+
+// a plain array: insert () shifts everything after the rank and rank ()
+// is a linear search, which is still the fastest for a few thousand items.
+class ShiftChain
+{
+    private:
+        std::vector<int>    Items;
+    public:
+        ShiftChain ();
+        ShiftChain (const ShiftChain &other);
+        ShiftChain &operator= (const ShiftChain &obj);
+        ~ShiftChain ();
+
+        void reset (size_t capacity);
+        void append (int item);
+        void insert (size_t rank, int item);
+
+        size_t size () const;
+        int at (size_t rank) const;
+        size_t rank (int item) const;
+        void copyTo (int *out) const;
+};
@@ -0,0 +1,428 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <vector>
+
+#include "MergeChain.hpp"
+#include "TaskPool.hpp"
+
+// Ford-Johnson merge-insertion on any random access range, with any strict
+// weak ordering: mergeInsertionSort (first, last) or (first, last, less).
+// it makes the fewest comparisons of any general method, which is the
+// point when a comparison is expensive (collation, records compared on a
+// computed key); byKey (extract) builds less from a key function.
+//
+// the sort itself runs on item numbers: MergeInsertion compares
+// values[elem[i]] and only ever moves ints, every level slicing one buffer
+// allocated up front. the main chain of a level is a ShiftChain while it
+// is short and a MergeChain past ShiftLimit items.
+//
+// how the values get there is chosen at compile time from the element
+// type: arithmetic types are copied once into a contiguous buffer, so
+// the comparisons read a flat array whatever the container (a deque
+// iterator has to find the block on every access), and copied back in
+// order. anything else is compared in place and put in order by following
+// the cycles of the permutation with std::swap, no element is copied.
+//
+// with a TaskPool the range is cut into a power of two runs, at least one
+// per thread, every run is sorted by its own engine as a task, and the
+// runs are merged up a balanced tree, big merges cut into pieces that fill
+// disjoint parts of the output. the merges add at most n log2 k
+// comparisons for k runs on top of the k sorts, each within F(n / k),
+// so a parallel sort is only bounded by k F(n / k) + n log2 k, not F(n).
+template <typename Iterator, typename Compare>
+class MergeInsertion
+{
+    private:
+        static const size_t ShiftLimit = 2048;
+
+        Iterator            Values;
+        Compare             Less;
+        std::vector<int>    Buffer;
+        MergeChain          Blocks;
+        ShiftChain          Shifts;
+
+        bool less (const int *elem, int a, int b)
+        {
+            return Less (Values[elem[a]], Values[elem[b]]);
+        }
+
+        // items 2j and 2j + 1 are paired, the larger ones form the next
+        // level (its elem right after this one, its pairs after these) and
+        // come back sorted in sorted[0, m / 2) as pair numbers
+        void level (int *elem, size_t m, int *pairs, int *sorted)
+        {
+            if (m == 1)
+            {
+                sorted[0] = 0;
+                return;
+            }
+            size_t half = m / 2;
+            int *next = elem + m;
+            for (size_t j = 0; j < half; j++)
+            {
+                bool firstBig = less (elem, 2 * j + 1, 2 * j);
+                pairs[2 * j] = firstBig ? 2 * j : 2 * j + 1;
+                pairs[2 * j + 1] = firstBig ? 2 * j + 1 : 2 * j;
+                next[j] = elem[pairs[2 * j]];
+            }
+            level (next, half, pairs + m, sorted);
+            if (m <= ShiftLimit)
+                insert (Shifts, elem, m, pairs, sorted);
+            else
+                insert (Blocks, elem, m, pairs, sorted);
+        }
+
+        // the main chain starts as the smaller of the first pair and all
+        // the larger ones, then the other smaller ones go in, in Jacobsthal
+        // batches (3 2, 5 4, 11 ... 6, ...), each searched only below its
+        // partner. sorted[0, m) is the answer of the level.
+        template <typename Chain>
+        void insert (Chain &chain, const int *elem, size_t m, const int *pairs, int *sorted)
+        {
+            size_t half = m / 2;
+            chain.reset (m);
+            chain.append (pairs[2 * sorted[0] + 1]);
+            for (size_t i = 0; i < half; i++)
+                chain.append (pairs[2 * sorted[i]]);
+
+            // pend i (1 based) is the smaller of the i-th pair, or the odd one out
+            size_t pend = half + m % 2;
+            size_t done = 1;
+            size_t batch = 3;
+            while (done < pend)
+            {
+                size_t last = batch < pend ? batch : pend;
+                for (size_t i = last; i > done; i--)
+                {
+                    int item;
+                    size_t bound;
+                    if (i <= half)
+                    {
+                        item = pairs[2 * sorted[i - 1] + 1];
+                        bound = chain.rank (pairs[2 * sorted[i - 1]]);
+                    }
+                    else
+                    {
+                        item = m - 1;
+                        bound = chain.size ();
+                    }
+                    size_t lo = 0;
+                    while (lo < bound)
+                    {
+                        size_t mid = lo + (bound - lo) / 2;
+                        int probe = chain.at (mid);
+                        if (less (elem, item, probe))
+                            bound = mid;
+                        else
+                            lo = mid + 1;
+                    }
+                    chain.insert (lo, item);
+                }
+                size_t following = batch + 2 * done;
+                done = last;
+                batch = following;
+            }
+            chain.copyTo (sorted);
+        }
+
+        static const size_t MinRun = 4096;
+
+        // a run (middle == end) or the merge of the two nodes under it.
+        // out is where its items go, in[begin, end) where the children put
+        // theirs; pending counts the children, then the pieces, still to go.
+        struct Node : public TaskPool::Task
+        {
+            MergeInsertion  *engine;
+            Node            *parent;
+            size_t          begin;
+            size_t          middle;
+            size_t          end;
+            int             *out;
+            const int       *in;
+            size_t          pending;
+            size_t          pieces;
+            size_t          firstPiece;
+
+            void run (TaskPool &pool, size_t worker) { engine->sortRun (*this, pool, worker); }
+        };
+
+        struct Piece : public TaskPool::Task
+        {
+            Node    *node;
+            size_t  index;
+
+            void run (TaskPool &pool, size_t worker) { node->engine->mergePiece (*node, index, pool, worker); }
+        };
+
+        std::vector<Node>   Nodes;
+        std::vector<Piece>  Pieces;
+
+        // the node for runs [first, last) of count over n items, writing
+        // to out; the children write to the other half of the buffer
+        Node *build (size_t first, size_t last, size_t count, size_t n, int *out, int *other, Node *parent)
+        {
+            Nodes.push_back (Node ());
+            Node *node = &Nodes.back ();
+            node->engine = this;
+            node->parent = parent;
+            node->begin = first * n / count;
+            node->end = last * n / count;
+            node->middle = node->end;
+            node->out = out;
+            node->in = other;
+            node->pending = 0;
+            node->pieces = 0;
+            if (last - first > 1)
+            {
+                size_t split = first + (last - first) / 2;
+                node->middle = split * n / count;
+                node->pending = 2;
+                build (first, split, count, n, other, out, node);
+                build (split, last, count, n, other, out, node);
+            }
+            return node;
+        }
+
+        void sortRun (Node &node, TaskPool &pool, size_t worker)
+        {
+            MergeInsertion run (Values + node.begin, Less);
+            const int *order = run.sort (node.end - node.begin);
+            for (size_t k = node.begin; k < node.end; k++)
+                node.out[k] = node.begin + *order++;
+            finish (node, pool, worker);
+        }
+
+        // the last child to finish starts the merge of its parent
+        void finish (Node &node, TaskPool &pool, size_t worker)
+        {
+            Node *parent = node.parent;
+            if (!parent || __atomic_sub_fetch (&parent->pending, 1, __ATOMIC_ACQ_REL) != 0)
+                return;
+            parent->pending = parent->pieces;
+            for (size_t i = 0; i < parent->pieces; i++)
+                pool.spawn (&Pieces[parent->firstPiece + i], worker);
+        }
+
+        // how many of the first k merged items come from the left run: the
+        // smallest i with right[k - i - 1] < left[i], so equal items keep
+        // their order
+        size_t split (const int *left, size_t leftSize, const int *right, size_t rightSize, size_t k)
+        {
+            size_t lo = k > rightSize ? k - rightSize : 0;
+            size_t hi = k < leftSize ? k : leftSize;
+            while (lo < hi)
+            {
+                size_t mid = lo + (hi - lo) / 2;
+                if (Less (Values[right[k - mid - 1]], Values[left[mid]]))
+                    hi = mid;
+                else
+                    lo = mid + 1;
+            }
+            return lo;
+        }
+
+        void mergePiece (Node &node, size_t index, TaskPool &pool, size_t worker)
+        {
+            const int *left = node.in + node.begin;
+            const int *right = node.in + node.middle;
+            size_t leftSize = node.middle - node.begin;
+            size_t rightSize = node.end - node.middle;
+            size_t size = leftSize + rightSize;
+            size_t from = size * index / node.pieces;
+            size_t to = size * (index + 1) / node.pieces;
+            size_t i = split (left, leftSize, right, rightSize, from);
+            size_t iEnd = index + 1 == node.pieces ? leftSize : split (left, leftSize, right, rightSize, to);
+            size_t j = from - i;
+            size_t jEnd = to - iEnd;
+            int *out = node.out + node.begin + from;
+            while (i < iEnd && j < jEnd)
+            {
+                if (Less (Values[right[j]], Values[left[i]]))
+                    *out++ = right[j++];
+                else
+                    *out++ = left[i++];
+            }
+            while (i < iEnd)
+                *out++ = left[i++];
+            while (j < jEnd)
+                *out++ = right[j++];
+            if (__atomic_sub_fetch (&node.pending, 1, __ATOMIC_ACQ_REL) == 0)
+                finish (node, pool, worker);
+        }
+    public:
+        MergeInsertion (Iterator values, Compare compare) : Values (values), Less (compare) {}
+        MergeInsertion (const MergeInsertion &other)
+            : Values (other.Values), Less (other.Less), Buffer (other.Buffer), Blocks (other.Blocks), Shifts (other.Shifts) {}
+        MergeInsertion &operator= (const MergeInsertion &obj)
+        {
+            Values = obj.Values;
+            Less = obj.Less;
+            Buffer = obj.Buffer;
+            Blocks = obj.Blocks;
+            Shifts = obj.Shifts;
+            return *this;
+        }
+        ~MergeInsertion () {}
+
+        // the sorted order of values[0, n): result[k] is the index of the
+        // k-th smallest. the buffer holds every level's elem and pairs
+        // (under 2n each) and the n results.
+        int *sort (size_t n)
+        {
+            Buffer.assign (5 * n, 0);
+            int *elem = &Buffer[0];
+            int *pairs = elem + 2 * n;
+            int *sorted = pairs + 2 * n;
+            for (size_t i = 0; i < n; i++)
+                elem[i] = i;
+            Blocks.reset (n);
+            Shifts.reset (n < ShiftLimit ? n : ShiftLimit);
+            level (elem, n, pairs, sorted);
+            return sorted;
+        }
+
+        // the same on pool. a merge gets a piece per thread's share of the
+        // whole range, so the last one still keeps every thread busy.
+        int *sort (size_t n, TaskPool &pool)
+        {
+            size_t runs = 1;
+            while (runs < pool.threads () && 2 * runs * MinRun <= n)
+                runs *= 2;
+            if (runs < 2)
+                return sort (n);
+            Buffer.assign (2 * n, 0);
+            Nodes.clear ();
+            Nodes.reserve (2 * runs);
+            build (0, runs, runs, n, &Buffer[0], &Buffer[n], NULL);
+
+            size_t pieces = 0;
+            std::vector<TaskPool::Task *> leaves;
+            for (size_t i = 0; i < Nodes.size (); i++)
+            {
+                Node &node = Nodes[i];
+                if (node.middle == node.end)
+                {
+                    leaves.push_back (&node);
+                    continue;
+                }
+                node.firstPiece = pieces;
+                node.pieces = (node.end - node.begin) * pool.threads () / n;
+                if (node.pieces == 0)
+                    node.pieces = 1;
+                pieces += node.pieces;
+            }
+            Pieces.assign (pieces, Piece ());
+            for (size_t i = 0; i < Nodes.size (); i++)
+                for (size_t p = 0; p < Nodes[i].pieces; p++)
+                {
+                    Pieces[Nodes[i].firstPiece + p].node = &Nodes[i];
+                    Pieces[Nodes[i].firstPiece + p].index = p;
+                }
+            pool.run (leaves);
+            return &Buffer[0];
+        }
+};
+
+template <typename T> struct IsScalar { static const bool value = false; };
+#define SCALAR(type) template <> struct IsScalar<type> { static const bool value = true; };
+SCALAR (char)
+SCALAR (signed char)
+SCALAR (unsigned char)
+SCALAR (short)
+SCALAR (unsigned short)
+SCALAR (int)
+SCALAR (unsigned int)
+SCALAR (long)
+SCALAR (unsigned long)
+SCALAR (long long)
+SCALAR (unsigned long long)
+SCALAR (float)
+SCALAR (double)
+SCALAR (long double)
+#undef SCALAR
+
+template <bool Scalar> struct Placement {};
+
+// scalars: sorted as a flat copy, then written back in order
+template <typename Iterator, typename Compare>
+void mergeInsertionSort (Iterator first, Iterator last, Compare less, Placement<true>, TaskPool *pool)
+{
+    typedef typename std::iterator_traits<Iterator>::value_type Value;
+    std::vector<Value> copy (first, last);
+    MergeInsertion<const Value *, Compare> engine (&copy[0], less);
+    const int *order = pool ? engine.sort (copy.size (), *pool) : engine.sort (copy.size ());
+    for (size_t k = 0; k < copy.size (); k++)
+        first[k] = copy[order[k]];
+}
+
+// anything else: sorted where it is, then every cycle of the permutation
+// is rotated into place with swaps. a position is marked done by making it
+// a fixed point.
+template <typename Iterator, typename Compare>
+void mergeInsertionSort (Iterator first, Iterator last, Compare less, Placement<false>, TaskPool *pool)
+{
+    size_t n = last - first;
+    MergeInsertion<Iterator, Compare> engine (first, less);
+    int *order = pool ? engine.sort (n, *pool) : engine.sort (n);
+    for (size_t start = 0; start < n; start++)
+    {
+        size_t j = start;
+        for (;;)
+        {
+            size_t k = order[j];
+            order[j] = j;
+            if (k == start)
+                break;
+            std::swap (first[j], first[k]);
+            j = k;
+        }
+    }
+}
+
+template <typename Iterator, typename Compare>
+void mergeInsertionSort (Iterator first, Iterator last, Compare less)
+{
+    typedef typename std::iterator_traits<Iterator>::value_type Value;
+    if (last - first < 2)
+        return;
+    mergeInsertionSort (first, last, less, Placement<IsScalar<Value>::value> (), static_cast<TaskPool *> (NULL));
+}
+
+// the same on the threads of pool, see MergeInsertion. less is called
+// from several threads at once.
+template <typename Iterator, typename Compare>
+void mergeInsertionSort (Iterator first, Iterator last, Compare less, TaskPool &pool)
+{
+    typedef typename std::iterator_traits<Iterator>::value_type Value;
+    if (last - first < 2)
+        return;
+    mergeInsertionSort (first, last, less, Placement<IsScalar<Value>::value> (), &pool);
+}
+
+template <typename Iterator>
+void mergeInsertionSort (Iterator first, Iterator last)
+{
+    typedef typename std::iterator_traits<Iterator>::value_type Value;
+    mergeInsertionSort (first, last, std::less<Value> ());
+}
+
+// less on a key: byKey (recordId) with any function or functor that takes
+// an element and returns something with <
+template <typename Extract>
+struct ByKey
+{
+    Extract extract;
+
+    ByKey (Extract extract) : extract (extract) {}
+    template <typename T>
+    bool operator() (const T &a, const T &b) const { return extract (a) < extract (b); }
+};
+
+template <typename Extract>
+ByKey<Extract> byKey (Extract extract)
+{
+    return ByKey<Extract> (extract);
+}
@@ -4,6 +4,8 @@
 #include <algorithm>
 #include <sstream>
 
+#include "MergeInsertion.hpp"
+
 class PmergeMe
 {
     public:
@@ -13,8 +15,6 @@ class PmergeMe
         ~PmergeMe();
 
         void sortVector (std::vector<int> &vect);
-        void makePairs (const std::vector<int> &vect, std::vector<int> &bigs, std::vector<int> &smalls, int &leftover);
-
+        void sortVector (std::vector<int> &vect, TaskPool &pool);
         void sortDeque (std::deque<int> &deq);
-        void makePairs (const std::deque<int> &deq, std::deque<int> &bigs, std::deque<int> &smalls, int &leftover);
     };
\ No newline at end of file
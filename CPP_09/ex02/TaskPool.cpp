@@ -0,0 +1,153 @@
+#include "TaskPool.hpp"
+
+#include <stdexcept>
+#include <unistd.h>
+
+TaskPool::TaskPool (size_t threads)
+    : Threads (threads ? threads : 1), Queues (Threads), Queued (0), Unfinished (0), Failed (false)
+{
+    for (size_t i = 0; i < Threads; i++)
+        pthread_mutex_init (&Queues[i].lock, NULL);
+    pthread_mutex_init (&Lock, NULL);
+    pthread_cond_init (&Wake, NULL);
+}
+
+TaskPool::~TaskPool ()
+{
+    pthread_cond_destroy (&Wake);
+    pthread_mutex_destroy (&Lock);
+    for (size_t i = 0; i < Threads; i++)
+        pthread_mutex_destroy (&Queues[i].lock);
+}
+
+size_t TaskPool::threads () const
+{
+    return Threads;
+}
+
+size_t TaskPool::defaultThreads ()
+{
+    long n = sysconf (_SC_NPROCESSORS_ONLN);
+    return n > 0 ? n : 1;
+}
+
+void *TaskPool::start (void *self)
+{
+    Start *s = static_cast<Start *> (self);
+    s->pool->work (s->worker);
+    return NULL;
+}
+
+// Queued goes up before the task is visible and down once it is taken,
+// so it is never below the real count and a worker that sees 0 can sleep
+void TaskPool::spawn (Task *task, size_t worker)
+{
+    __atomic_add_fetch (&Unfinished, 1, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch (&Queued, 1, __ATOMIC_SEQ_CST);
+    Queue &own = Queues[worker];
+    pthread_mutex_lock (&own.lock);
+    own.tasks.push_back (task);
+    pthread_mutex_unlock (&own.lock);
+
+    pthread_mutex_lock (&Lock);
+    pthread_cond_signal (&Wake);
+    pthread_mutex_unlock (&Lock);
+}
+
+// the newest task of worker's own queue, or else the oldest of the next
+// queue that has one
+TaskPool::Task *TaskPool::take (size_t worker)
+{
+    Task *task = NULL;
+    for (size_t i = 0; i < Threads && !task; i++)
+    {
+        Queue &queue = Queues[(worker + i) % Threads];
+        pthread_mutex_lock (&queue.lock);
+        if (!queue.tasks.empty ())
+        {
+            if (i == 0)
+            {
+                task = queue.tasks.back ();
+                queue.tasks.pop_back ();
+            }
+            else
+            {
+                task = queue.tasks.front ();
+                queue.tasks.pop_front ();
+            }
+        }
+        pthread_mutex_unlock (&queue.lock);
+    }
+    if (task)
+        __atomic_sub_fetch (&Queued, 1, __ATOMIC_SEQ_CST);
+    return task;
+}
+
+void TaskPool::work (size_t worker)
+{
+    while (true)
+    {
+        Task *task = take (worker);
+        if (task)
+        {
+            std::string error;
+            try
+            {
+                task->run (*this, worker);
+            }
+            catch (const std::exception &e)
+            {
+                error = e.what ();
+            }
+            catch (...)
+            {
+                error = "Error: task failed";
+            }
+            pthread_mutex_lock (&Lock);
+            if (!error.empty () && !Failed)
+            {
+                Failed = true;
+                Error = error;
+            }
+            if (__atomic_sub_fetch (&Unfinished, 1, __ATOMIC_SEQ_CST) == 0)
+                pthread_cond_broadcast (&Wake);
+            pthread_mutex_unlock (&Lock);
+            continue;
+        }
+
+        pthread_mutex_lock (&Lock);
+        while (__atomic_load_n (&Unfinished, __ATOMIC_SEQ_CST) != 0
+            && __atomic_load_n (&Queued, __ATOMIC_SEQ_CST) == 0)
+            pthread_cond_wait (&Wake, &Lock);
+        bool finished = __atomic_load_n (&Unfinished, __ATOMIC_SEQ_CST) == 0;
+        pthread_mutex_unlock (&Lock);
+        if (finished)
+            return;
+    }
+}
+
+void TaskPool::run (const std::vector<Task *> &tasks)
+{
+    Failed = false;
+    Error.clear ();
+    for (size_t i = 0; i < tasks.size (); i++)
+        spawn (tasks[i], i % Threads);
+
+    // the calling thread is worker 0, so a pool of one starts no thread
+    std::vector<Start> starts (Threads);
+    std::vector<pthread_t> threads;
+    for (size_t i = 1; i < Threads; i++)
+    {
+        starts[i].pool = this;
+        starts[i].worker = i;
+        pthread_t t;
+        if (pthread_create (&t, NULL, &TaskPool::start, &starts[i]) != 0)
+            break;
+        threads.push_back (t);
+    }
+    work (0);
+    for (size_t i = 0; i < threads.size (); i++)
+        pthread_join (threads[i], NULL);
+    if (Failed)
+        throw std::runtime_error (Error);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <vector>
+#include <pthread.h>
+
+// a work-stealing pool: every thread keeps its own queue of tasks, takes
+// the newest one from it and, when it runs dry, steals the oldest one of
+// another thread. tasks spawn more tasks onto the queue of the thread
+// running them, so related work stays on one core unless someone is idle.
+// the pool doesn't own tasks, they have to outlive run ().
+class TaskPool
+{
+    public:
+        class Task
+        {
+            public:
+                virtual ~Task () {}
+                // worker is the index of the thread running it, for spawn ()
+                virtual void run (TaskPool &pool, size_t worker) = 0;
+        };
+
+        TaskPool (size_t threads);
+        ~TaskPool ();
+
+        // runs tasks and everything they spawn on the calling thread and
+        // threads () - 1 others, returns once all of it is done. the first
+        // exception a task throws is thrown again from here, the tasks
+        // already queued still run.
+        void run (const std::vector<Task *> &tasks);
+        // only from a task running on worker
+        void spawn (Task *task, size_t worker);
+
+        size_t threads () const;
+
+        static size_t defaultThreads ();
+    private:
+        struct Queue
+        {
+            pthread_mutex_t     lock;
+            std::deque<Task *>  tasks;
+        };
+
+        struct Start
+        {
+            TaskPool    *pool;
+            size_t      worker;
+        };
+
+        size_t              Threads;
+        std::vector<Queue>  Queues;
+        size_t              Queued;
+        size_t              Unfinished;
+        bool                Failed;
+        std::string         Error;
+        pthread_mutex_t     Lock;
+        pthread_cond_t      Wake;
+
+        TaskPool (const TaskPool &other);
+        TaskPool &operator= (const TaskPool &obj);
+
+        Task *take (size_t worker);
+        void work (size_t worker);
+        static void *start (void *self);
+};
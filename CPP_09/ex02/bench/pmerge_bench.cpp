@@ -0,0 +1,146 @@
+#include "../Instrumented.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+#include <time.h>
+
+// merge-insertion against std::sort and std::stable_sort, for growing n
+// and four input shapes, as csv on stdout. each row is one algorithm on
+// one input: the comparisons, element moves and heap allocations of an
+// instrumented run (Tracked<int> elements, a CountingLess), the best time
+// of runs plain ones on int, and the two bounds on comparisons: F(n),
+// what Ford-Johnson guarantees, and ceil (log2 n!), what any comparison
+// sort needs in the worst case. ford_johnson_parallel is the same sort on
+// a TaskPool of threads threads, its speedup is its time against the
+// ford_johnson row.
+// usage: ./pmerge_bench [max_n] [runs] [threads] > pmerge_bench.csv
+
+static unsigned long Allocations = 0;
+static TaskPool *Pool = NULL;
+
+// every allocation of the process goes through here, the counter is read
+// before and after a run. the default operator delete frees what malloc
+// returned, so it stays.
+void *operator new (size_t size) throw (std::bad_alloc)
+{
+    __atomic_add_fetch (&Allocations, 1, __ATOMIC_RELAXED);
+    void *p = malloc (size ? size : 1);
+    if (!p)
+        throw std::bad_alloc ();
+    return p;
+}
+
+static double now ()
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+enum Shape { Random, Sorted, Reversed, Duplicates };
+static const char *const ShapeNames[] = { "random", "sorted", "reversed", "duplicates" };
+
+enum Algorithm { FordJohnson, ParallelFordJohnson, StdSort, StableSort };
+static const char *const AlgorithmNames[] = { "ford_johnson", "ford_johnson_parallel", "std_sort", "std_stable_sort" };
+
+static std::vector<int> generate (Shape shape, size_t n)
+{
+    std::vector<int> values (n);
+    srand (42);
+    for (size_t i = 0; i < n; i++)
+    {
+        if (shape == Random)
+            values[i] = rand ();
+        else if (shape == Sorted)
+            values[i] = i;
+        else if (shape == Reversed)
+            values[i] = n - i;
+        else
+            values[i] = rand () % 16;
+    }
+    return values;
+}
+
+template <typename Iterator, typename Compare>
+static void run (Algorithm algorithm, Iterator first, Iterator last, Compare less)
+{
+    if (algorithm == FordJohnson)
+        mergeInsertionSort (first, last, less);
+    else if (algorithm == ParallelFordJohnson)
+        mergeInsertionSort (first, last, less, *Pool);
+    else if (algorithm == StdSort)
+        std::sort (first, last, less);
+    else
+        std::stable_sort (first, last, less);
+}
+
+// ceil (log2 n!)
+static unsigned long informationBound (size_t n)
+{
+    double bits = 0;
+    for (size_t k = 2; k <= n; k++)
+        bits += std::log (static_cast<double> (k)) / std::log (2.0);
+    return static_cast<unsigned long> (std::ceil (bits - 1e-9));
+}
+
+static void measure (Algorithm algorithm, Shape shape, size_t n, int runs, unsigned long fj, unsigned long info)
+{
+    std::vector<int> input = generate (shape, n);
+
+    SortCounters counters;
+    std::vector<Tracked<int> > tracked (input.begin (), input.end ());
+    Tracked<int>::counters = &counters;
+    unsigned long before = Allocations;
+    run (algorithm, tracked.begin (), tracked.end (), CountingLess<std::less<Tracked<int> > > (&counters));
+    counters.allocations = Allocations - before;
+    Tracked<int>::counters = NULL;
+    for (size_t i = 1; i < n; i++)
+        if (tracked[i] < tracked[i - 1])
+        {
+            std::cerr << AlgorithmNames[algorithm] << ": not sorted" << std::endl;
+            exit (1);
+        }
+
+    double best = 0;
+    for (int r = 0; r < runs; r++)
+    {
+        std::vector<int> values (input);
+        double start = now ();
+        run (algorithm, values.begin (), values.end (), std::less<int> ());
+        double elapsed = now () - start;
+        if (r == 0 || elapsed < best)
+            best = elapsed;
+    }
+
+    printf ("%s,%s,%lu,%lu,%lu,%lu,%.1f,%lu,%lu\n", AlgorithmNames[algorithm], ShapeNames[shape],
+            static_cast<unsigned long> (n), counters.comparisons, counters.moves, counters.allocations,
+            best * 1e6, fj, info);
+}
+
+int main (int argc, char **argv)
+{
+    size_t maxN = argc > 1 ? atol (argv[1]) : 1 << 18;
+    int runs = argc > 2 ? atoi (argv[2]) : 3;
+    if (runs < 1)
+        runs = 1;
+    TaskPool pool (argc > 3 ? atol (argv[3]) : TaskPool::defaultThreads ());
+    Pool = &pool;
+
+    printf ("algorithm,distribution,n,comparisons,moves,allocations,us,ford_johnson_bound,information_bound\n");
+    for (size_t n = 16; n <= maxN; n *= 4)
+    {
+        unsigned long fj = fordJohnsonBound (n);
+        unsigned long info = informationBound (n);
+        for (int shape = Random; shape <= Duplicates; shape++)
+            for (int algorithm = FordJohnson; algorithm <= StableSort; algorithm++)
+                measure (static_cast<Algorithm> (algorithm), static_cast<Shape> (shape), n, runs, fj, info);
+        fflush (stdout);
+    }
+    return 0;
+}